@@ -66,7 +66,7 @@ static void glfw_error_callback(int error, const char* description)
 }
 
 // Logic
-static void SpawnClients(int count, int groupMaxCount)
+static void SpawnClients(int count, int groupMaxCount, bool usePipelinedHandshake)
 {
     if (count <= 0) return;
 
@@ -88,7 +88,7 @@ static void SpawnClients(int count, int groupMaxCount)
         clientIndexInGroup++;
 
         auto client = std::make_shared<VirtualClient>(io_context, i, "127.0.0.1", 53200, currentGroupId, groupIndex, clientIndexInGroup);
-        client->Start(EnqueueHistory);
+        client->Start(EnqueueHistory, usePipelinedHandshake);
 
         std::lock_guard<std::mutex> groupLock(groupsMapMutex);
         groupsMap[currentGroupId].push_back(client->GetUuid());
@@ -135,6 +135,12 @@ static void StopAllClients()
     };
     std::map<std::string, GroupStats> groupStatsMap;
 
+    ll totalTimeToReady = 0;
+    ll readyCount = 0;
+    int maxTimeToReady = 0;
+    ll totalTimeToFirstTick = 0;
+    ll firstTickCount = 0;
+    int maxTimeToFirstTick = 0;
     int highestClientMaxRtt = 0;
     double highestClientAvgRtt = 0.0;
 
@@ -142,6 +148,20 @@ static void StopAllClients()
     {
         auto stats = client->GetStats();
 
+        // Handshake latency of connected clients
+        if (client->GetState() == ClientState::Connected)
+        {
+            totalTimeToReady += stats.timeToReadyMs;
+            readyCount++;
+            maxTimeToReady = std::max(maxTimeToReady, stats.timeToReadyMs);
+        }
+        if (stats.timeToFirstTickMs > 0)
+        {
+            totalTimeToFirstTick += stats.timeToFirstTickMs;
+            firstTickCount++;
+            maxTimeToFirstTick = std::max(maxTimeToFirstTick, stats.timeToFirstTickMs);
+        }
+
         // Update overall client max stats
         if (stats.maxRtt > highestClientMaxRtt) highestClientMaxRtt = stats.maxRtt;
         double avg = stats.GetAvgRtt();
@@ -186,11 +206,15 @@ static void StopAllClients()
         csvFile << "Highest Client Max RTT," << highestClientMaxRtt << "\n";
         csvFile << "Highest Client Avg RTT," << highestClientAvgRtt << "\n";
         csvFile << "Highest Group Avg RTT," << highestGroupAvgRtt << "\n";
+        csvFile << "Avg Time To Ready (ms)," << (readyCount > 0 ? (double)totalTimeToReady / readyCount : 0.0) << "\n";
+        csvFile << "Max Time To Ready (ms)," << maxTimeToReady << "\n";
+        csvFile << "Avg Time To First Tick (ms)," << (firstTickCount > 0 ? (double)totalTimeToFirstTick / firstTickCount : 0.0) << "\n";
+        csvFile << "Max Time To First Tick (ms)," << maxTimeToFirstTick << "\n";
         csvFile << "\n";
 
         // --- Client Stats ---
         csvFile << "--- Client Stats ---\n";
-        csvFile << "ClientID,GroupID,MinRTT,AvgRTT,MaxRTT,TxPackets,RxPackets\n";
+        csvFile << "ClientID,GroupID,MinRTT,AvgRTT,MaxRTT,TxPackets,RxPackets,TimeToReady,TimeToFirstTick\n";
 
         for (auto& client : clients)
         {
@@ -199,7 +223,7 @@ static void StopAllClients()
 
             csvFile << client->GetId() << "," << client->GetGroupId() << ","
                 << validMinRtt << "," << stats.GetAvgRtt() << "," << stats.maxRtt << ","
-                << stats.txPackets << "," << stats.rxPackets << "\n";
+                << stats.txPackets << "," << stats.rxPackets << "," << stats.timeToReadyMs << "," << stats.timeToFirstTickMs << "\n";
         }
         csvFile << "\n";
 
@@ -308,6 +332,7 @@ int main(int, char**)
     
     int targetClientCount = 10;
     int groupMaxCount = 5;
+    bool usePipelinedHandshake = true;
 
     // Graph Data
     #define HISTORY_SIZE 300
@@ -441,14 +466,15 @@ int main(int, char**)
             }
 #endif
 
-            ImGui::InputInt("Client Count", &targetClientCount, 2, 500);
+            ImGui::InputInt("Client Count", &targetClientCount, 2, 5000);
             ImGui::InputInt("Client per Group", &groupMaxCount, 5, 500);
+            ImGui::Checkbox("Pipelined Handshake", &usePipelinedHandshake);
 
             if (ImGui::Button("Spawn Clients"))
             {
-                targetClientCount = std::min(targetClientCount, 500);
+                targetClientCount = std::min(targetClientCount, 5000);
                 groupMaxCount = std::min(groupMaxCount, 500);
-                SpawnClients(targetClientCount, groupMaxCount);
+                SpawnClients(targetClientCount, groupMaxCount, usePipelinedHandshake);
             }
             ImGui::SameLine();
             if (ImGui::Button("Stop All"))
@@ -464,6 +490,11 @@ int main(int, char**)
             // Calculate Stats
             int connectedCount = 0;
             int handshakeCount = 0;
+            ll totalTimeToReady = 0;
+            int maxTimeToReady = 0;
+            ll totalTimeToFirstTick = 0;
+            int firstTickCount = 0;
+            int maxTimeToFirstTick = 0;
 
             for (auto& c : clients)
             {
@@ -472,6 +503,19 @@ int main(int, char**)
                 else if (s != ClientState::Disconnected && s != ClientState::Error) handshakeCount++;
 
                 auto stats = c->GetStats();
+                if (s == ClientState::Connected)
+                {
+                    totalTimeToReady += stats.timeToReadyMs;
+                    maxTimeToReady = std::max(maxTimeToReady, stats.timeToReadyMs);
+                }
+
+                if (stats.timeToFirstTickMs > 0)
+                {
+                    totalTimeToFirstTick += stats.timeToFirstTickMs;
+                    firstTickCount++;
+                    maxTimeToFirstTick = std::max(maxTimeToFirstTick, stats.timeToFirstTickMs);
+                }
+
                 if (stats.rttMs > 0)
                 {
                     gTotalRtt += stats.rttMs;
@@ -489,6 +533,10 @@ int main(int, char**)
 
             ImGui::Text("Connected: %d", connectedCount);
             ImGui::Text("Handshaking: %d", handshakeCount);
+            ImGui::Text("Time To Ready: avg %.1f ms / max %d ms",
+                connectedCount > 0 ? (double)totalTimeToReady / connectedCount : 0.0, maxTimeToReady);
+            ImGui::Text("Time To First Tick: avg %.1f ms / max %d ms",
+                firstTickCount > 0 ? (double)totalTimeToFirstTick / firstTickCount : 0.0, maxTimeToFirstTick);
 
             // Rtt History
             if (ImGui::BeginTable("Rtt history", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
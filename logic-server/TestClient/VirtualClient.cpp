@@ -32,11 +32,15 @@ VirtualClient::~VirtualClient()
     Stop();
 }
 
-void VirtualClient::Start(std::function<void(SHistory history)> enqueueHistory)
+void VirtualClient::Start(std::function<void(SHistory history)> enqueueHistory, bool usePipelinedHandshake)
 {
     if (_state != ClientState::Disconnected) return;
 
+    if (!usePipelinedHandshake)
+        _clientCapabilities &= ~NetworkProtocol::CAPABILITY_PIPELINED_HANDSHAKE;
+
     _state = ClientState::Connecting;
+    _connectStartTime = std::chrono::steady_clock::now();
     DoConnect();
 
     _enqueueHistory = std::move(enqueueHistory);
@@ -349,6 +353,11 @@ void VirtualClient::DoConnect()
         if (!ec)
         {
             self->_state = ClientState::Handshake_Udp;
+
+            // pipelined : hello goes out without waiting for the server prompt
+            if (self->_clientCapabilities & NetworkProtocol::CAPABILITY_PIPELINED_HANDSHAKE)
+                self->SendHello();
+
             self->DoReadHeader();
         }
         else if(ec == boost::asio::error::connection_refused)
@@ -476,6 +485,25 @@ void VirtualClient::HandleGameInfoPacket(const RpcPacket& packet)
 
 void VirtualClient::HandleUdpPortExchange(const RpcPacket& packet)
 {
+    // accept of the offered capabilities : [token(4)][capabilities(4)]
+    if (packet.data().size() == sizeof(std::uint32_t) * 2)
+    {
+        std::uint32_t tokenNet;
+        std::uint32_t acceptedCapabilitiesNet;
+        std::memcpy(&tokenNet, packet.data().data(), sizeof(tokenNet));
+        std::memcpy(&acceptedCapabilitiesNet, packet.data().data() + sizeof(tokenNet), sizeof(acceptedCapabilitiesNet));
+
+        _udpToken = ntohl(tokenNet);
+        _capabilities = ntohl(acceptedCapabilitiesNet) & _clientCapabilities;
+        if (_udpToken == NetworkProtocol::INVALID_SESSION_TOKEN)
+            _capabilities &= ~NetworkProtocol::CAPABILITY_UDP_TOKEN;
+
+        // pipelined hello accepted : the next message is the joined GROUP_INFO
+        if (_capabilities & NetworkProtocol::CAPABILITY_PIPELINED_HANDSHAKE)
+            _state = ClientState::Handshake_GroupInfo;
+        return;
+    }
+
     // 1. Get Server UDP Port
     std::uint16_t serverUdpPortNet;
     if (packet.data().size() >= sizeof(serverUdpPortNet))
@@ -485,16 +513,27 @@ void VirtualClient::HandleUdpPortExchange(const RpcPacket& packet)
 
         _serverUdpEndpoint = udp::endpoint(_tcpSocket.remote_endpoint().address(), serverUdpPort);
 
+        // hello already answered this prompt, an old server keeps prompting USER_INFO / GROUP_INFO
+        if (_isHelloSent)
+        {
+            _state = ClientState::Handshake_UserInfo;
+            return;
+        }
+
         // 2. Setup Local UDP
         SetupUdp();
 
-        // 3. Send Local UDP Port
+        // 3. Send Local UDP Port + Offered Capabilities
         std::uint16_t localPort = _udpSocket.local_endpoint().port();
         std::uint16_t localPortNet = htons(localPort);
+        std::uint32_t capabilitiesNet = htonl(_clientCapabilities);
+
+        std::string responseData(reinterpret_cast<char*>(&localPortNet), sizeof(localPortNet));
+        responseData.append(reinterpret_cast<char*>(&capabilitiesNet), sizeof(capabilitiesNet));
 
         RpcPacket response;
         response.set_method(UDP_PORT);
-        response.set_data(std::string(reinterpret_cast<char*>(&localPortNet), sizeof(localPortNet)));
+        response.set_data(responseData);
         SendTcpPacket(response);
 
         _state = ClientState::Handshake_UserInfo;
@@ -513,6 +552,13 @@ void VirtualClient::HandleUserInfoExchange(const RpcPacket& packet)
 
 void VirtualClient::HandleGroupInfoExchange(const RpcPacket& packet)
 {
+    // pipelined : server reply of the hello, nothing to send back
+    if (_capabilities & NetworkProtocol::CAPABILITY_PIPELINED_HANDSHAKE)
+    {
+        OnHandshakeComplete();
+        return;
+    }
+
     // Send Group Info
     GroupDto groupDto;
     groupDto.set_groupid(_groupId);
@@ -522,8 +568,46 @@ void VirtualClient::HandleGroupInfoExchange(const RpcPacket& packet)
     response.set_data(groupDto.SerializeAsString());
     SendTcpPacket(response);
 
+    OnHandshakeComplete();
+}
+
+void VirtualClient::SendHello()
+{
+    SetupUdp();
+
+    // [udpPort(2)][capabilities(4)][usernameSize(2)][username][GroupDto]
+    std::uint16_t localPortNet = htons(_udpSocket.local_endpoint().port());
+    std::uint32_t capabilitiesNet = htonl(_clientCapabilities);
+    std::uint16_t usernameSizeNet = htons(static_cast<std::uint16_t>(_displayUserId.size()));
+
+    GroupDto groupDto;
+    groupDto.set_groupid(_groupId);
+
+    std::string helloData(reinterpret_cast<char*>(&localPortNet), sizeof(localPortNet));
+    helloData.append(reinterpret_cast<char*>(&capabilitiesNet), sizeof(capabilitiesNet));
+    helloData.append(reinterpret_cast<char*>(&usernameSizeNet), sizeof(usernameSizeNet));
+    helloData.append(_displayUserId);
+    helloData.append(groupDto.SerializeAsString());
+
+    RpcPacket hello;
+    hello.set_method(UDP_PORT);
+    hello.set_uid(_uuid);
+    hello.set_data(helloData);
+    SendTcpPacket(hello);
+
+    _isHelloSent = true;
+}
+
+void VirtualClient::OnHandshakeComplete()
+{
     _state = ClientState::Connected;
 
+    {
+        std::lock_guard<std::mutex> lock(_statsMutex);
+        _stats.timeToReadyMs = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - _connectStartTime).count());
+    }
+
     // Start UDP receive loop
     DoUdpReceive();
 }
@@ -549,7 +633,16 @@ void VirtualClient::DoUdpReceive()
             std::memcpy(&payloadSize, self->_udpBuffer, 2);
             payloadSize = ntohs(payloadSize);
 
-            if (payloadSize > 0 && payloadSize + 2 <= bytes_transferred)
+            const bool isBundle = (self->_capabilities & NetworkProtocol::CAPABILITY_UDP_BUNDLE) != 0
+                && (payloadSize & NetworkProtocol::UDP_BUNDLE_FLAG) != 0;
+            if (isBundle)
+            {
+                // Bundle Body : [size(2)][RpcPacket]...
+                const std::size_t bundleSize = payloadSize & NetworkProtocol::UDP_SIZE_MASK;
+                if (bundleSize + 2 <= bytes_transferred)
+                    self->HandleUdpBundle(self->_udpBuffer + 2, bundleSize);
+            }
+            else if (payloadSize > 0 && payloadSize + 2 <= bytes_transferred)
             {
                 RpcPacket packet;
                 if (packet.ParseFromArray(self->_udpBuffer + 2, payloadSize))
@@ -563,11 +656,40 @@ void VirtualClient::DoUdpReceive()
     });
 }
 
+void VirtualClient::HandleUdpBundle(const char* data, std::size_t size)
+{
+    std::size_t offset = 0;
+    while (offset + 2 <= size)
+    {
+        uint16_t recordSize;
+        std::memcpy(&recordSize, data + offset, 2);
+        recordSize = ntohs(recordSize);
+        offset += 2;
+
+        if (recordSize == 0 || offset + recordSize > size)
+            break;
+
+        RpcPacket packet;
+        if (packet.ParseFromArray(data + offset, recordSize))
+        {
+            HandleUdpPacket(packet);
+        }
+
+        offset += recordSize;
+    }
+}
+
 void VirtualClient::HandleUdpPacket(const RpcPacket& packet)
 {
     {
         std::lock_guard<std::mutex> lock(_statsMutex);
         _stats.rxPackets++;
+
+        if (_stats.timeToFirstTickMs == 0)
+        {
+            _stats.timeToFirstTickMs = std::max(1, static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - _connectStartTime).count()));
+        }
     }
 
     switch (packet.method())
@@ -690,24 +812,44 @@ void VirtualClient::SendUdpPacket(const RpcPacket& packet)
 {
     if (_state != ClientState::Connected) return;
 
-    std::string data = packet.SerializeAsString();
-    if (data.size() > 65000) return; // UDP limit safety
+    const bool useToken = (_capabilities & NetworkProtocol::CAPABILITY_UDP_TOKEN) != 0;
+
+    std::string data;
+    if (useToken)
+    {
+        // Server resolves sender by token, uid is not sent
+        RpcPacket compactPacket(packet);
+        compactPacket.clear_uid();
+        data = compactPacket.SerializeAsString();
+    }
+    else
+    {
+        data = packet.SerializeAsString();
+    }
+
+    if (data.size() > NetworkProtocol::UDP_SIZE_MASK) return; // UDP limit safety
 
     uint16_t size = static_cast<uint16_t>(data.size());
-    uint16_t netSize = htons(size);
+    uint16_t netSize = htons(useToken ? (size | NetworkProtocol::UDP_TOKEN_FLAG) : size);
+    const std::size_t headerSize = useToken ? 2 + sizeof(_udpToken) : 2;
 
-    // Buffer: [Length(2)][Protobuf Payload]
-    auto buffer = std::make_shared<std::vector<char>>(2 + size);
+    // Buffer: [Length(2)][Protobuf Payload] or [Length(2) | Token Flag][Token(4)][Protobuf Payload]
+    auto buffer = std::make_shared<std::vector<char>>(headerSize + size);
     std::memcpy(buffer->data(), &netSize, 2);
-    std::memcpy(buffer->data() + 2, data.data(), size);
+    if (useToken)
+    {
+        uint32_t netToken = htonl(_udpToken);
+        std::memcpy(buffer->data() + 2, &netToken, sizeof(netToken));
+    }
+    std::memcpy(buffer->data() + headerSize, data.data(), size);
 
     auto self(shared_from_this());
     _udpSocket.async_send_to(boost::asio::buffer(*buffer), _serverUdpEndpoint,
-        [self, buffer, netSize, size](const boost::system::error_code& ec, std::size_t bytes_transferred)
+        [self, buffer](const boost::system::error_code& ec, std::size_t bytes_transferred)
     {
         if (!ec)
         {
-            self->_bytesSentSinceLastTick += (2 + size);
+            self->_bytesSentSinceLastTick += bytes_transferred;
             std::lock_guard<std::mutex> lock(self->_statsMutex);
             self->_stats.txPackets++;
         }
@@ -17,6 +17,7 @@ Made with GEMINI CLI
 #include <mutex>
 #include <format>
 #include "../logic-server/NetworkData.pb.h"
+#include "../logic-server/NetworkProtocol.h"
 
 using namespace NetworkData;
 
@@ -69,6 +70,11 @@ struct ClientStats
     double txBps = 0.0;
     double rxBps = 0.0;
 
+    // connect ~ handshake complete (0 until connected)
+    int timeToReadyMs = 0;
+    // connect ~ first udp packet from the server (0 until received)
+    int timeToFirstTickMs = 0;
+
     double GetAvgRtt() const 
     {
         return rttCount > 0 ? (double)totalRtt / rttCount : 0.0;
@@ -100,7 +106,7 @@ public:
     VirtualClient(boost::asio::io_context& io_context, int id, std::string serverIp, int serverPort, std::string groupId, int groupIndex, int indexInGroup);
     ~VirtualClient();
 
-    void Start(std::function<void(SHistory history)> enqueueHistory);
+    void Start(std::function<void(SHistory history)> enqueueHistory, bool usePipelinedHandshake = true);
     void Stop();
 
     // Called from UI thread to get data for visualization
@@ -138,10 +144,13 @@ private:
     void HandleUdpPortExchange(const RpcPacket& packet);
     void HandleUserInfoExchange(const RpcPacket& packet);
     void HandleGroupInfoExchange(const RpcPacket& packet);
+    void SendHello();
+    void OnHandshakeComplete();
 
     // UDP Handlers
     void SetupUdp();
     void DoUdpReceive();
+    void HandleUdpBundle(const char* data, std::size_t size);
     void HandleUdpPacket(const RpcPacket& packet);
 
     // Helpers
@@ -173,6 +182,12 @@ private:
     udp::socket _udpSocket;
     udp::endpoint _serverUdpEndpoint;
 
+    // negotiated in UDP_PORT exchange
+    std::uint32_t _clientCapabilities = NetworkProtocol::CAPABILITY_UDP_TOKEN | NetworkProtocol::CAPABILITY_UDP_BUNDLE | NetworkProtocol::CAPABILITY_PIPELINED_HANDSHAKE;
+    std::uint32_t _capabilities = NetworkProtocol::CAPABILITY_NONE;
+    std::uint32_t _udpToken = NetworkProtocol::INVALID_SESSION_TOKEN;
+    bool _isHelloSent = false;
+
     std::atomic<ClientState> _state{ ClientState::Disconnected };
     mutable std::mutex _statsMutex;
     ClientStats _stats;
@@ -192,6 +207,9 @@ private:
     
     char _udpBuffer[4096];
     
+    // Handshake measurement
+    std::chrono::steady_clock::time_point _connectStartTime;
+
     // Ping measurement
     std::chrono::steady_clock::time_point _lastPingTime;
     boost::asio::steady_timer _pingTimer;
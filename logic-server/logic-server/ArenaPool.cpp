@@ -0,0 +1,40 @@
+#include "ArenaPool.h"
+
+#include <atomic>
+
+#include "Monitor.h"
+
+ArenaPool::ArenaPool(std::size_t arenaCount, std::size_t initialBlockSize)
+    : _initialBlockSize(initialBlockSize)
+{
+    _entries.reserve(arenaCount);
+    for (std::size_t i = 0; i < arenaCount; ++i)
+    {
+        auto entry = std::make_shared<SEntry>(_initialBlockSize);
+        _entries.emplace_back(entry, &entry->arena);
+    }
+}
+
+std::shared_ptr<google::protobuf::Arena> ArenaPool::Acquire()
+{
+    // round robin from the last hit, the oldest arenas are the most likely to be released
+    for (std::size_t scanned = 0; scanned < _entries.size(); ++scanned)
+    {
+        auto& arena = _entries[_cursor];
+        _cursor = (_cursor + 1) % _entries.size();
+
+        if (arena.use_count() != 1)
+            continue;
+
+        // pairs with the release of the last packet reference on another thread before the memory is reused
+        std::atomic_thread_fence(std::memory_order_acquire);
+        arena->Reset(); // keeps the initial block, frees the blocks a big batch added
+        return arena;
+    }
+
+    ConsoleMonitor::Get().IncrementArenaPoolFallback();
+
+    google::protobuf::ArenaOptions options;
+    options.start_block_size = _initialBlockSize;
+    return std::make_shared<google::protobuf::Arena>(options);
+}
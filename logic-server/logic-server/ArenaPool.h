@@ -0,0 +1,39 @@
+#pragma once
+#include <google/protobuf/arena.h>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// fixed pool of protobuf arenas for one receive strand, inbound packets of a batch are parsed into one arena
+// an arena is free again once the last packet parsed into it is released (only the pool holds it),
+// then it is reset and reused with its preallocated initial block, so steady state never touches the heap
+// not thread safe : Acquire runs on the owning strand only
+class ArenaPool
+{
+public:
+    ArenaPool(std::size_t arenaCount, std::size_t initialBlockSize);
+
+    ArenaPool(const ArenaPool&) = delete;
+    ArenaPool& operator=(const ArenaPool&) = delete;
+
+    // falls back to a heap arena when every pooled arena is still referenced
+    std::shared_ptr<google::protobuf::Arena> Acquire();
+
+private:
+    // the block and its arena are owned together, a packet that outlives the pool keeps both
+    struct SEntry
+    {
+        explicit SEntry(std::size_t initialBlockSize)
+            : initialBlock(std::make_unique<char[]>(initialBlockSize)), arena(initialBlock.get(), initialBlockSize)
+        {
+        }
+
+        std::unique_ptr<char[]> initialBlock; // declared first, destroyed after the arena
+        google::protobuf::Arena arena;
+    };
+
+    std::size_t _initialBlockSize;
+    std::vector<std::shared_ptr<google::protobuf::Arena>> _entries; // aliases into SEntry
+    std::size_t _cursor = 0;
+};
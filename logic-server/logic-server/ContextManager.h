@@ -25,6 +25,9 @@ public:
     // For Use BlockingPool (use this for heavy work)
     ThreadPool& GetBlockingPool() { return _blockingPool; }
 
+    // io_context thread count (not including blocking pool)
+    std::size_t GetThreadCount() const { return _ctxThreads.size(); }
+
 private:
     asio::io_context _ctx;
     ThreadPool _blockingPool;
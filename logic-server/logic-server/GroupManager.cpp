@@ -25,12 +25,12 @@ void GroupManager::Stop()
     spdlog::info("all groups are stopped (use_count: {})", weak_from_this().use_count());
 }
 
-void GroupManager::AddSession(const std::shared_ptr<GroupDto> groupDto, const std::shared_ptr<Session>& newSession)
+bool GroupManager::AddSession(const std::shared_ptr<GroupDto> groupDto, const std::shared_ptr<Session>& newSession)
 {
     auto joinGroupId = uuids::uuid::from_string(groupDto->groupid());
     if(!joinGroupId) {
          spdlog::error("invalid group id: {}", groupDto->groupid());
-         return;
+         return false;
     }
 
     std::lock_guard<std::mutex> groupLock(_groupMutex);
@@ -42,14 +42,14 @@ void GroupManager::AddSession(const std::shared_ptr<GroupDto> groupDto, const st
         if (group->IsFull())
         {
             spdlog::error("fatal error: {} is full (invalid situation)", uuids::to_string(groupId));
-            return;
+            return false;
         }
 
         group->AddMember(newSession);
 
         spdlog::info("session {} is allocated to group {}", uuids::to_string(newSession->GetSessionUuid()), uuids::to_string(groupId));
         newSession->Start();
-        return;
+        return true;
     }
 
     const auto newGroup = CreateNewGroup(groupDto);
@@ -59,6 +59,7 @@ void GroupManager::AddSession(const std::shared_ptr<GroupDto> groupDto, const st
 
     _groups[newGroup->GetGroupId()] = newGroup;
     ConsoleMonitor::Get().UpdateGroupCount((int)_groups.size());
+    return true;
 }
 
 std::shared_ptr<LockstepGroup> GroupManager::CreateNewGroup(const std::shared_ptr<GroupDto> groupDto)
@@ -31,7 +31,8 @@ public:
 
     void Stop();
 
-    void AddSession(const std::shared_ptr<GroupDto> groupDto, const std::shared_ptr<Session>& newSession);
+    // false : invalid group id or full group, the session is not started
+    bool AddSession(const std::shared_ptr<GroupDto> groupDto, const std::shared_ptr<Session>& newSession);
     void RemoveEmptyGroup(const std::shared_ptr<LockstepGroup> emptyGroup);
 
 private:
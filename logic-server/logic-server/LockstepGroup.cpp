@@ -1,16 +1,19 @@
 #include "LockstepGroup.h"
 
+#include <algorithm>
 #include <utility>
 
 #include "Session.h"
 #include "Util.h"
 #include "Scheduler.h"
 #include "ContextManager.h"
+#include "UdpFrame.h"
 
 LockstepGroup::LockstepGroup(const std::shared_ptr<ContextManager>& ctxManager, const std::shared_ptr<GroupDto> newGroupDtoPtr)
     : _ctxManager(ctxManager), _privateStrand(_ctxManager->GetContext()), _groupInfo(newGroupDtoPtr)
 {
     _fixedDeltaMs = TICK_TIME; // Delay Time
+    _memberStates.Reserve(_maxSessionCount);
 }
 
 void LockstepGroup::SetNotifyEmptyCallback(NotifyEmptyCallback notifyEmptyCallback)
@@ -55,11 +58,15 @@ void LockstepGroup::Stop(bool forceStop)
 
 void LockstepGroup::AddMember(const std::shared_ptr<Session>& newSession)
 {
+    const auto memberId = newSession->GetSessionUuid();
     {
         std::lock_guard<std::mutex> lock(_memberMutex);
-        _members[newSession->GetSessionUuid()] = newSession;
+        _members[memberId] = newSession;
     }
 
+    auto self(shared_from_this());
+    asio::post(_privateStrand, [self, memberId]() { self->_memberStates.Add(memberId); });
+
     auto weakSelf(weak_from_this());
     newSession->SetStopCallbackByGroup([weakSelf](const std::shared_ptr<Session>& session)
     {
@@ -67,10 +74,10 @@ void LockstepGroup::AddMember(const std::shared_ptr<Session>& newSession)
             self->RemoveMember(session);
     });
 
-    newSession->SetCollectInputAction([weakSelf](std::shared_ptr<std::pair<uuid, std::shared_ptr<RpcPacket>>> rpcRequest)
+    newSession->SetCollectInputAction([weakSelf](const std::shared_ptr<SSendPacket>& input)
     {
         if (auto self = weakSelf.lock())
-            self->CollectInput(std::move(rpcRequest));
+            self->CollectInput(input);
     });
 
     spdlog::info("{} : added member {}", _groupInfo->groupid(), uuids::to_string(newSession->GetSessionUuid()));
@@ -88,31 +95,36 @@ void LockstepGroup::RemoveMember(const std::shared_ptr<Session>& session)
             isGroupEmpty = _members.empty();
         }
 
+        auto self(shared_from_this());
+        asio::post(_privateStrand, [self, memberId = session->GetSessionUuid()]() { self->_memberStates.Remove(memberId); });
+
         if(isGroupEmpty)
             Stop(false);
     }
 }
 
-void LockstepGroup::CollectInput(std::shared_ptr<std::pair<uuid, std::shared_ptr<RpcPacket>>> rpcRequest)
+void LockstepGroup::CollectInput(std::shared_ptr<SSendPacket> input)
 {
-    const auto [guid, request] = *rpcRequest;
-    SSendPacket newInput = { _inputCounter++, guid, request };
+    const auto method = input->packet->method();
+    spdlog::info("{} collect input: session {} - {}", _groupInfo->groupid(), uuids::to_string(input->guid), Util::MethodToString(method));
+
+    // numbered before it is published, read-only afterwards
+    input->packetNumber = _inputCounter++;
+    std::shared_ptr<const SSendPacket> atkInput = method == RpcMethod::Atk ? input : nullptr;
 
     {
         std::lock_guard<std::mutex> bufferLock(_bufferMutex);
-        _inputBuffer[_currentBucket].push_back(std::make_shared<SSendPacket>(newInput));
+        _inputBuffer[_currentBucket].push_back(std::move(input));
     }
 
-    spdlog::info("{} collect input: session {} - {}", _groupInfo->groupid(), uuids::to_string(guid), Util::MethodToString(request->method()));
-
-    if (request->method() != RpcMethod::Atk)
+    if (atkInput == nullptr)
     {
         return;
     }
 
     // make hit packet after check valid attack
     auto self(shared_from_this());
-    asio::post(_privateStrand, [self, request]() { self->AsyncMakeHitPacket(request); });
+    asio::post(_privateStrand, [self, atkInput]() { self->AsyncMakeHitPacket(atkInput); });
 }
 
 void LockstepGroup::Tick(CompletionHandler onComplete)
@@ -127,32 +139,71 @@ void LockstepGroup::Tick(CompletionHandler onComplete)
     auto self(shared_from_this());
     asio::post(_ctxManager->GetBlockingPool(), [self, onComplete]()
     {
+        // take the bucket out so its packets (and their arenas) are freed after fan-out
         std::list<std::shared_ptr<SSendPacket>> currentBucketPackets;
+        std::uint32_t tick;
         {
             std::lock_guard<std::mutex> bufferLock(self->_bufferMutex);
-            currentBucketPackets = self->_inputBuffer[self->_currentBucket];
+            tick = static_cast<std::uint32_t>(self->_currentBucket);
+            auto bucketNode = self->_inputBuffer.extract(self->_currentBucket);
+            if (!bucketNode.empty())
+                currentBucketPackets = std::move(bucketNode.mapped());
+
+            ++self->_currentBucket;
+        }
+
+        // serialize each input once, members only share the frame list
+        auto tickFrames = std::make_shared<UdpFrameList>();
+        tickFrames->reserve(currentBucketPackets.size());
+        for (const auto& input : currentBucketPackets)
+        {
+            // combat results are paced ahead of movement
+            const auto method = input->packet->method();
+            const auto priority = method == RpcMethod::Hit || method == RpcMethod::Atk ? UdpFrame::Priority::High : UdpFrame::Priority::Normal;
+
+            auto frame = UdpFrame::Serialize(*input->packet, priority);
+            if (frame == nullptr)
+            {
+                spdlog::error("{} : tick packet serialize failed ({})", self->_groupInfo->groupid(), Util::MethodToString(input->packet->method()));
+                continue;
+            }
+
+            tickFrames->push_back(std::move(frame));
         }
 
-        asio::post(self->_privateStrand, [self, onComplete, currentBucketPackets]()
+        // bundled once as well, for members that decode bundles
+        auto tickBundles = std::make_shared<const UdpFrameList>(UdpFrame::Bundle(*tickFrames, self->_udpBundleMtu));
+
+        asio::post(self->_privateStrand, [self, onComplete, tick, inputs = std::move(currentBucketPackets), frames = std::shared_ptr<const UdpFrameList>(std::move(tickFrames)), bundles = std::move(tickBundles)]()
         {
+            // state store is written by the strand only
+            self->ApplyInputs(inputs, tick);
+
             std::lock_guard<std::mutex> memberLock(self->_memberMutex);
+            if (!inputs.empty())
+                self->PublishMemberStates();
+
             for (const auto& [uid, member] : self->_members)
             {
+                if (frames->empty())
+                    break;
+
                 if (!member->IsValid())
                     continue;
 
-                member->EnqueueSendUdpPackets(currentBucketPackets);
+                member->EnqueueSendUdpFrames(member->HasCapability(NetworkProtocol::CAPABILITY_UDP_BUNDLE) ? bundles : frames);
             }
 
-            ++self->_currentBucket;
             self->_inputCounter = 0;
             onComplete();
         });
     });
 }
 
-void LockstepGroup::AsyncMakeHitPacket(std::shared_ptr<RpcPacket> atkPacket)
+void LockstepGroup::AsyncMakeHitPacket(std::shared_ptr<const SSendPacket> atkInput)
 {
+    const RpcPacket* atkPacket = atkInput->packet;
+
     // AABB check
     auto attackerUid = uuids::uuid::from_string(atkPacket->uid());
     if(!attackerUid) return;
@@ -160,47 +211,51 @@ void LockstepGroup::AsyncMakeHitPacket(std::shared_ptr<RpcPacket> atkPacket)
     if (atkPacket->data().empty())
         return;
 
-    AtkData atkData;
-    if (!atkData.ParseFromString(atkPacket->data()))
+    alignas(std::max_align_t) char arenaBlock[PARSE_ARENA_BLOCK_SIZE];
+    google::protobuf::Arena parseArena(arenaBlock, sizeof(arenaBlock));
+    auto* atkData = google::protobuf::Arena::Create<AtkData>(&parseArena);
+    if (!atkData->ParseFromString(atkPacket->data()))
     {
         spdlog::error("[internal] parsing error by atk data");
         return;
     }
 
-    auto victimUid = uuids::uuid::from_string(atkData.victim());
+    auto victimUid = uuids::uuid::from_string(atkData->victim());
     if(!victimUid) return;
 
-    Util::SUserState attackerState;
-    Util::SUserState victimState;
+    // runs on the strand, the state store is read without lock
+    const auto attackerSlot = _memberStates.Find(*attackerUid);
+    if (attackerSlot == MemberStateStore::INVALID_SLOT)
+    {
+        spdlog::error("invalid attacker uid (attacker: {})", atkPacket->uid());
+        return;
+    }
 
+    const auto victimSlot = _memberStates.Find(*victimUid);
+    if (victimSlot == MemberStateStore::INVALID_SLOT)
     {
-        std::lock_guard<std::mutex> memberLock(_memberMutex);
-        auto attackerIt = _members.find(*attackerUid);
-        auto victimIt = _members.find(*victimUid);
+        spdlog::error("attacker {} invalid victim uid (victim: {})", atkPacket->uid(), atkData->victim());
+        return;
+    }
 
-        if (attackerIt == _members.end())
-        {
-            spdlog::error("invalid attacker uid (attacker: {})", atkPacket->uid());
-            return;
-        }
+    // lag compensation : the attacker aimed at where the victim was about one rtt ago
+    std::uint64_t attackerRtt = 0;
+    {
+        std::lock_guard<std::mutex> memberLock(_memberMutex);
+        if (const auto attackerIt = _members.find(*attackerUid); attackerIt != _members.end())
+            attackerRtt = attackerIt->second->GetLastRtt();
+    }
 
-        if (victimIt == _members.end())
-        {
-            spdlog::error("attacker {} invalid victim uid (victim: {})", atkPacket->uid(), atkData.victim());
-            for (const auto& [id, session] : _members)
-            {
-                spdlog::info("session {} in group {}", uuids::to_string(id), _groupInfo->groupid());
-            }
-            return;
-        }
+    const auto rewindTicks = static_cast<std::uint32_t>(std::min(attackerRtt, _maxHitRewindMs) / _fixedDeltaMs);
+    const auto currentTick = static_cast<std::uint32_t>(_currentBucket);
+    const auto seenTick = currentTick > rewindTicks ? currentTick - rewindTicks : 0;
 
-        attackerState = attackerIt->second->GetGameState();
-        victimState = victimIt->second->GetGameState();
-    }
+    const auto attackerState = _memberStates.Get(attackerSlot);
+    const auto victimPosition = _memberStates.GetPositionAt(victimSlot, seenTick);
 
     // Find User
     auto attackerAABB = Util::SAABB::MakeAABB(attackerState.position.x, attackerState.position.y, attackerState.position.z, 0.5f);
-    auto victimAABB = Util::SAABB::MakeAABB(victimState.position.x, victimState.position.y, victimState.position.z, 0.5f);
+    auto victimAABB = Util::SAABB::MakeAABB(victimPosition.x, victimPosition.y, victimPosition.z, 0.5f);
 
     if (attackerAABB != victimAABB)
     {
@@ -208,17 +263,72 @@ void LockstepGroup::AsyncMakeHitPacket(std::shared_ptr<RpcPacket> atkPacket)
     }
 
     auto self(shared_from_this());
-    asio::post(_privateStrand, [self, atkData, attackerUid, victimUid]()
+    asio::post(_privateStrand, [self, dmg = atkData->dmg(), attackerUid, victimUid]()
+    {
+        // victim hit rpc packet, *attackerUid dereference
+        self->CollectInput(MakeHitPacket(*attackerUid, *victimUid, dmg));
+    });
+}
+
+void LockstepGroup::PublishMemberStates()
+{
+    // snapshot of this tick, sessions read it without lock
+    for (const auto& [uid, member] : _members)
     {
-        auto hitPacket = std::make_shared<RpcPacket>();
-        // *attackerUid dereference
-        MakeHitPacket(*attackerUid, *victimUid, hitPacket, atkData.dmg());
+        const auto slot = _memberStates.Find(uid);
+        if (slot != MemberStateStore::INVALID_SLOT)
+            member->PublishGameState(_memberStates.Get(slot));
+    }
+}
 
-        // victim hit rpc packet
-        auto requestPacket = std::make_shared<std::pair<uuid, std::shared_ptr<RpcPacket>>>();
-        requestPacket->first = *victimUid;
-        requestPacket->second = hitPacket;
+void LockstepGroup::ApplyInputs(const std::list<std::shared_ptr<SSendPacket>>& inputs, std::uint32_t tick)
+{
+    // payloads of one tick are parsed into one arena
+    alignas(std::max_align_t) char arenaBlock[PARSE_ARENA_BLOCK_SIZE];
+    google::protobuf::Arena parseArena(arenaBlock, sizeof(arenaBlock));
 
-        self->CollectInput(std::move(requestPacket));
-    });
-}
\ No newline at end of file
+    for (const auto& input : inputs)
+    {
+        const RpcPacket& packet = *input->packet;
+        switch (packet.method())
+        {
+        case RpcMethod::MoveStart:
+        case RpcMethod::Move:
+        case RpcMethod::MoveStop:
+        {
+            const auto slot = _memberStates.Find(input->guid);
+            if (slot == MemberStateStore::INVALID_SLOT)
+                break;
+
+            auto* moveData = google::protobuf::Arena::Create<MoveData>(&parseArena);
+            if (!moveData->ParseFromString(packet.data()))
+            {
+                spdlog::error("{} error parsing move data for member state", packet.uid());
+                break;
+            }
+
+            _memberStates.SetPosition(slot, moveData->x(), moveData->y(), moveData->z(), tick);
+            break;
+        }
+        case RpcMethod::Hit:
+        {
+            // hit packet is owned by the victim (MakeHitPacket)
+            const auto slot = _memberStates.Find(input->guid);
+            if (slot == MemberStateStore::INVALID_SLOT)
+                break;
+
+            auto* hitData = google::protobuf::Arena::Create<HitData>(&parseArena);
+            if (!hitData->ParseFromString(packet.data()) || hitData->dmg() < 0)
+            {
+                spdlog::error("[internal] invalid hit data, owner: {}", packet.uid());
+                break;
+            }
+
+            _memberStates.ApplyDamage(slot, hitData->dmg());
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
@@ -17,6 +17,7 @@
 
 #include "Base.h"
 #include "PacketProcess.h"
+#include "MemberStateStore.h"
 #include "NetworkData.pb.h"
 
 using IoContext = asio::io_context;
@@ -31,13 +32,6 @@ class ContextManager;
 
 constexpr int TICK_TIME = 33;
 
-struct SSendPacket
-{
-    std::size_t packetNumber;
-    uuid guid;
-    std::shared_ptr<RpcPacket> packet; // uid inclusive
-};
-
 class LockstepGroup final : public Base<LockstepGroup>
 {
 public:
@@ -54,7 +48,7 @@ public:
 	void Stop(bool forceStop) override;
 	void AddMember(const std::shared_ptr<Session>& newSession);
 	void RemoveMember(const std::shared_ptr<Session>& session);
-	void CollectInput(std::shared_ptr<std::pair<uuid, std::shared_ptr<RpcPacket>>> rpcRequest);
+	void CollectInput(std::shared_ptr<SSendPacket> input);
 	void Tick(CompletionHandler onComplete);
 
 	uuid GetGroupId() const { return *uuid::from_string(_groupInfo->groupid()); }
@@ -65,9 +59,12 @@ public:
 		return _members.size() == _maxSessionCount;
 	}
 
-    void AsyncMakeHitPacket(std::shared_ptr<RpcPacket> atkPacket);
+    void AsyncMakeHitPacket(std::shared_ptr<const SSendPacket> atkInput);
 
 private:
+    void ApplyInputs(const std::list<std::shared_ptr<SSendPacket>>& inputs, std::uint32_t tick); // group strand only
+    void PublishMemberStates(); // group strand, _memberMutex held
+
 	std::shared_ptr<ContextManager> _ctxManager;
     asio::io_context::strand _privateStrand;
 
@@ -77,7 +74,14 @@ private:
 	std::unordered_map<uuid, std::shared_ptr<Session>> _members;
 	const std::size_t _maxSessionCount = 500;
 
+    // written on _privateStrand only (member add / remove, tick inputs)
+    MemberStateStore _memberStates;
+
+    // hit validation rewinds the victim by the attacker rtt, at most this far
+    const std::uint64_t _maxHitRewindMs = 500;
+
 	std::size_t _fixedDeltaMs;
+    const std::size_t _udpBundleMtu = 1200; // bundled tick datagram size limit, safe under common path MTUs
     std::atomic<std::size_t> _currentBucket = 0;
 
 	std::mutex _bufferMutex;
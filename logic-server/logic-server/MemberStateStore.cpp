@@ -0,0 +1,109 @@
+#include "MemberStateStore.h"
+
+void MemberStateStore::Reserve(std::size_t capacity)
+{
+    _x.reserve(capacity);
+    _y.reserve(capacity);
+    _z.reserve(capacity);
+    _hp.reserve(capacity);
+    _history.reserve(capacity);
+    _ids.reserve(capacity);
+    _slots.reserve(capacity);
+}
+
+MemberStateStore::Slot MemberStateStore::Add(const uuid& memberId)
+{
+    if (const auto it = _slots.find(memberId); it != _slots.end())
+        return it->second;
+
+    const auto slot = static_cast<Slot>(_ids.size());
+    _x.push_back(0.0f);
+    _y.push_back(0.0f);
+    _z.push_back(0.0f);
+    _hp.push_back(0);
+    _history.emplace_back();
+    _ids.push_back(memberId);
+    _slots.emplace(memberId, slot);
+    return slot;
+}
+
+void MemberStateStore::Remove(const uuid& memberId)
+{
+    const auto it = _slots.find(memberId);
+    if (it == _slots.end())
+        return;
+
+    const Slot slot = it->second;
+    const Slot lastSlot = static_cast<Slot>(_ids.size() - 1);
+    _slots.erase(it);
+
+    if (slot != lastSlot)
+    {
+        _x[slot] = _x[lastSlot];
+        _y[slot] = _y[lastSlot];
+        _z[slot] = _z[lastSlot];
+        _hp[slot] = _hp[lastSlot];
+        _history[slot] = _history[lastSlot];
+        _ids[slot] = _ids[lastSlot];
+        _slots[_ids[slot]] = slot;
+    }
+
+    _x.pop_back();
+    _y.pop_back();
+    _z.pop_back();
+    _hp.pop_back();
+    _history.pop_back();
+    _ids.pop_back();
+}
+
+MemberStateStore::Slot MemberStateStore::Find(const uuid& memberId) const
+{
+    const auto it = _slots.find(memberId);
+    return it == _slots.end() ? INVALID_SLOT : it->second;
+}
+
+void MemberStateStore::SetPosition(Slot slot, float x, float y, float z, std::uint32_t tick)
+{
+    _x[slot] = x;
+    _y[slot] = y;
+    _z[slot] = z;
+
+    // several moves in one tick keep only the last one
+    auto& history = _history[slot];
+    if (history.count == 0 || history.samples[history.newest].tick != tick)
+    {
+        history.newest = (history.newest + 1) % POSITION_HISTORY_SIZE;
+        if (history.count < POSITION_HISTORY_SIZE)
+            ++history.count;
+    }
+
+    history.samples[history.newest] = { tick, x, y, z };
+}
+
+Util::SPos MemberStateStore::GetPositionAt(Slot slot, std::uint32_t tick) const
+{
+    Util::SPos position;
+    const auto& history = _history[slot];
+    if (history.count == 0)
+    {
+        // never moved
+        position.SetPosition(_x[slot], _y[slot], _z[slot]);
+        return position;
+    }
+
+    // newest to oldest, a recent tick is found within a few samples
+    std::uint32_t index = history.newest;
+    for (std::uint32_t i = 0; i < history.count; ++i)
+    {
+        const auto& sample = history.samples[index];
+        if (sample.tick <= tick || i + 1 == history.count)
+        {
+            position.SetPosition(sample.x, sample.y, sample.z);
+            return position;
+        }
+
+        index = (index + POSITION_HISTORY_SIZE - 1) % POSITION_HISTORY_SIZE;
+    }
+
+    return position;
+}
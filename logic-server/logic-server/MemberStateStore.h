@@ -0,0 +1,74 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <unordered_map>
+
+#include <stduuid/uuid.h>
+
+#include "Util.h"
+
+using uuids::uuid;
+
+// game state of every group member as a structure of arrays, indexed by a dense member slot
+// single writer : the owning group strand, reads on that strand need no lock
+class MemberStateStore
+{
+public:
+    using Slot = std::uint32_t;
+    static constexpr Slot INVALID_SLOT = std::numeric_limits<Slot>::max();
+
+    // position samples kept per member for lag compensation, ~1s at TICK_TIME
+    static constexpr std::size_t POSITION_HISTORY_SIZE = 32;
+
+    void Reserve(std::size_t capacity);
+
+    Slot Add(const uuid& memberId);
+    void Remove(const uuid& memberId); // the last slot is moved into the hole, slots stay dense
+    Slot Find(const uuid& memberId) const;
+
+    // tick : group tick the position belongs to, recorded in the member history
+    void SetPosition(Slot slot, float x, float y, float z, std::uint32_t tick);
+
+    void ApplyDamage(Slot slot, std::int32_t dmg) { _hp[slot] -= dmg; }
+
+    Util::SUserState Get(Slot slot) const
+    {
+        Util::SUserState state;
+        state.hp = _hp[slot];
+        state.position.SetPosition(_x[slot], _y[slot], _z[slot]);
+        return state;
+    }
+
+    // newest recorded position at or before tick, the oldest sample when the ring does not reach that far back
+    Util::SPos GetPositionAt(Slot slot, std::uint32_t tick) const;
+
+    std::size_t Size() const { return _ids.size(); }
+
+private:
+    struct SPositionSample
+    {
+        std::uint32_t tick;
+        float x;
+        float y;
+        float z;
+    };
+
+    // fixed ring per member, written in place : no allocation after the member is added
+    struct SPositionHistory
+    {
+        std::array<SPositionSample, POSITION_HISTORY_SIZE> samples;
+        std::uint32_t newest = 0;
+        std::uint32_t count = 0;
+    };
+
+    std::vector<float> _x;
+    std::vector<float> _y;
+    std::vector<float> _z;
+    std::vector<std::int32_t> _hp;
+    std::vector<SPositionHistory> _history;
+
+    std::vector<uuid> _ids; // slot -> member
+    std::unordered_map<uuid, Slot> _slots; // member -> slot
+};
@@ -86,6 +86,30 @@ void ConsoleMonitor::UpdateLatency(int ms)
 
 void ConsoleMonitor::IncrementTcpPacket() { _tcpPacketCounter++; }
 void ConsoleMonitor::IncrementUdpPacket() { _udpPacketCounter++; }
+void ConsoleMonitor::IncrementArenaPoolFallback() { _arenaPoolFallbackCount++; }
+void ConsoleMonitor::IncrementUdpDropped() { _udpDroppedCount++; }
+void ConsoleMonitor::IncrementUdpRateLimited() { _udpRateLimitedCount++; }
+void ConsoleMonitor::IncrementUdpSendSyscall() { _udpSendSyscallCounter++; }
+void ConsoleMonitor::IncrementUdpEgressRetry(std::size_t count) { _udpEgressRetryCounter += static_cast<long long>(count); }
+void ConsoleMonitor::IncrementUdpEgressFull() { _udpEgressFullCount++; }
+void ConsoleMonitor::IncrementTcpSendCoalesced() { _tcpSendCoalescedCount++; }
+void ConsoleMonitor::IncrementTcpSendOverflow() { _tcpSendOverflowCount++; }
+
+void ConsoleMonitor::UpdateUdpEgressDepth(std::size_t depth)
+{
+    std::size_t peak = _udpEgressDepthPeak.load(std::memory_order_relaxed);
+    while (depth > peak && !_udpEgressDepthPeak.compare_exchange_weak(peak, depth, std::memory_order_relaxed))
+    {
+    }
+}
+
+void ConsoleMonitor::UpdateTcpSendQueueDepth(std::size_t depth)
+{
+    std::size_t peak = _tcpSendQueueDepthPeak.load(std::memory_order_relaxed);
+    while (depth > peak && !_tcpSendQueueDepthPeak.compare_exchange_weak(peak, depth, std::memory_order_relaxed))
+    {
+    }
+}
 
 void ConsoleMonitor::UpdateErrorRate() 
 {
@@ -99,6 +123,10 @@ void ConsoleMonitor::UpdateStatus() {
     if (diff >= 1000) { // 1초마다 갱신
         _tcpPps = (_tcpPacketCounter.exchange(0) * 1000 / diff);
         _udpPps = (_udpPacketCounter.exchange(0) * 1000 / diff);
+        _udpSendSyscallPs = (_udpSendSyscallCounter.exchange(0) * 1000 / diff);
+        _udpEgressRetryPs = (_udpEgressRetryCounter.exchange(0) * 1000 / diff);
+        _udpEgressDepthPeakPs = _udpEgressDepthPeak.exchange(0);
+        _tcpSendQueueDepthPeakPs = _tcpSendQueueDepthPeak.exchange(0);
 
         UpdateErrorRate();
         _lastPpsTime = now;
@@ -165,7 +193,7 @@ void ConsoleMonitor::Draw() {
         ci.Attributes = FOREGROUND_WHITE;
     }
 
-    int statsHeight = 8; // 하단 통계영역 높이 (구분선 포함)
+    int statsHeight = 14; // 하단 통계영역 높이 (구분선 포함)
     int logAreaHeight = bufferSize.Y - statsHeight;
     if (logAreaHeight < 0) logAreaHeight = 0;
 
@@ -251,9 +279,21 @@ void ConsoleMonitor::Draw() {
     std::wstringstream ssMemory;
     ssMemory << std::fixed << std::setprecision(2) << _memorySize.load() << L" MB";
     DrawStatLine(5, L"Memory Usage", ssMemory.str());
+    DrawStatLine(6, L"Arena Pool Fallback", std::to_wstring(_arenaPoolFallbackCount.load()));
+    DrawStatLine(7, L"UDP Dropped", std::to_wstring(_udpDroppedCount.load()));
+    DrawStatLine(8, L"UDP Rate Limited", std::to_wstring(_udpRateLimitedCount.load()));
+    DrawStatLine(9, L"UDP Send Syscall/Sec", std::to_wstring(_udpSendSyscallPs.load()));
+
+    std::wstringstream ssEgress;
+    ssEgress << L"Depth Peak: " << _udpEgressDepthPeakPs << L" / Retry/Sec: " << _udpEgressRetryPs << L" / Full: " << _udpEgressFullCount;
+    DrawStatLine(10, L"UDP Egress Ring", ssEgress.str());
+
+    std::wstringstream ssTcpQueue;
+    ssTcpQueue << L"Depth Peak: " << _tcpSendQueueDepthPeakPs << L" / Coalesced: " << _tcpSendCoalescedCount << L" / Overflow: " << _tcpSendOverflowCount;
+    DrawStatLine(11, L"TCP Send Queue", ssTcpQueue.str());
 
     // Help Text
-    int helpRow = statsStartRow + 6;
+    int helpRow = statsStartRow + 12;
     if (helpRow < bufferSize.Y) {
         std::wstring helpText = L" [SYSTEM] Monitor Active. Press ENTER to exit.";
         for (size_t i = 0; i < helpText.length(); ++i) {
@@ -39,6 +39,16 @@ public:
     void UpdateErrorRate();
     void IncrementTcpPacket();
     void IncrementUdpPacket();
+    void IncrementArenaPoolFallback();
+    void IncrementUdpDropped();
+    void IncrementUdpRateLimited();
+    void IncrementUdpSendSyscall();
+    void IncrementUdpEgressRetry(std::size_t count);
+    void IncrementUdpEgressFull();
+    void UpdateUdpEgressDepth(std::size_t depth);
+    void UpdateTcpSendQueueDepth(std::size_t depth);
+    void IncrementTcpSendCoalesced();
+    void IncrementTcpSendOverflow();
 
 private:
     ConsoleMonitor();
@@ -82,7 +92,31 @@ private:
     std::atomic<long long> _udpPacketCounter = 0;
     std::atomic<int> _tcpPps = 0;
     std::atomic<int> _udpPps = 0;
+    std::atomic<long long> _udpSendSyscallCounter = 0;
+    std::atomic<int> _udpSendSyscallPs = 0;
+
+    // Udp egress ring (peak depth and CAS retries per second, datagrams dropped on a full ring)
+    std::atomic<std::size_t> _udpEgressDepthPeak = 0;
+    std::atomic<std::size_t> _udpEgressDepthPeakPs = 0;
+    std::atomic<long long> _udpEgressRetryCounter = 0;
+    std::atomic<int> _udpEgressRetryPs = 0;
+    std::atomic<long long> _udpEgressFullCount = 0;
+
+    // Tcp send queue (peak session depth per second, game states replaced by a newer one, sessions dropped at the hard cap)
+    std::atomic<std::size_t> _tcpSendQueueDepthPeak = 0;
+    std::atomic<std::size_t> _tcpSendQueueDepthPeakPs = 0;
+    std::atomic<long long> _tcpSendCoalescedCount = 0;
+    std::atomic<long long> _tcpSendOverflowCount = 0;
     std::chrono::steady_clock::time_point _lastPpsTime;
+
+    // Dropped udp datagrams (unknown sender, invalid token, uid mismatch)
+    std::atomic<long long> _udpDroppedCount = 0;
+
+    // Udp datagrams over the ingress token bucket (dropped before parsing)
+    std::atomic<long long> _udpRateLimitedCount = 0;
+
+    // Receive arena pool (heap fallback must stay 0 in steady state)
+    std::atomic<long long> _arenaPoolFallbackCount = 0;
 };
 
 // spdlog 커스텀 Sink (색상 없이 텍스트만 전달)
@@ -0,0 +1,113 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// bounded lock-free ring, many producers and one consumer
+// every cell carries a sequence number : a producer claims a position with one CAS, then publishes the cell
+template <typename T>
+class MpscRing
+{
+public:
+    static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+    // capacity is rounded up to a power of two
+    explicit MpscRing(std::size_t capacity)
+    {
+        std::size_t roundedCapacity = 2;
+        while (roundedCapacity < capacity)
+            roundedCapacity <<= 1;
+
+        _mask = roundedCapacity - 1;
+        _cells = std::make_unique<SCell[]>(roundedCapacity);
+        for (std::size_t i = 0; i < roundedCapacity; ++i)
+        {
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    // false when full, retryCount is increased by the CAS retries lost to other producers
+    bool TryPush(T&& value, std::size_t& retryCount)
+    {
+        std::size_t position = _enqueuePosition.load(std::memory_order_relaxed);
+        SCell* cell;
+        for (;;)
+        {
+            cell = &_cells[position & _mask];
+            const std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const auto difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+
+            if (difference == 0)
+            {
+                if (_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+
+                ++retryCount;
+            }
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = _enqueuePosition.load(std::memory_order_relaxed);
+                ++retryCount;
+            }
+        }
+
+        cell->value = std::move(value);
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer only, false when the next cell is not published yet
+    bool TryPop(T& out)
+    {
+        const std::size_t position = _dequeuePosition.load(std::memory_order_relaxed);
+        SCell& cell = _cells[position & _mask];
+        const std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        if (static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position + 1) < 0)
+            return false;
+
+        out = std::move(cell.value);
+        cell.value = T();
+        cell.sequence.store(position + _mask + 1, std::memory_order_release);
+        _dequeuePosition.store(position + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // claimed but not yet consumed, may include cells still being published
+    // dequeue position first : it never passes the enqueue position read after it
+    std::size_t Size() const
+    {
+        const std::size_t dequeuePosition = _dequeuePosition.load(std::memory_order_seq_cst);
+        const std::size_t enqueuePosition = _enqueuePosition.load(std::memory_order_seq_cst);
+        const auto difference = static_cast<std::intptr_t>(enqueuePosition - dequeuePosition);
+        if (difference <= 0)
+            return 0;
+
+        return std::min(static_cast<std::size_t>(difference), Capacity());
+    }
+
+    bool Empty() const { return Size() == 0; }
+    std::size_t Capacity() const { return _mask + 1; }
+
+private:
+    struct alignas(CACHE_LINE_SIZE) SCell
+    {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<SCell[]> _cells;
+    std::size_t _mask;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> _enqueuePosition = 0;
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> _dequeuePosition = 0;
+};
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+
+// wire constants shared by the server and the TestClient
+namespace NetworkProtocol
+{
+    // udp datagram framing
+    // [size(2)][RpcPacket]                          : sender resolved by RpcPacket.uid
+    // [size(2) | UDP_TOKEN_FLAG][token(4)][RpcPacket] : sender resolved by session token, uid may be omitted
+    constexpr std::uint16_t UDP_TOKEN_FLAG = 0x8000;
+    constexpr std::uint16_t UDP_SIZE_MASK = 0x7FFF;
+
+    // server -> client bundle, only sent to clients that accepted CAPABILITY_UDP_BUNDLE
+    // [size(2) | UDP_BUNDLE_FLAG][size(2)][RpcPacket][size(2)][RpcPacket]... : size of the header covers every record
+    constexpr std::uint16_t UDP_BUNDLE_FLAG = 0x8000;
+
+    constexpr std::uint32_t INVALID_SESSION_TOKEN = 0;
+
+    // capability bits negotiated in the UDP_PORT exchange
+    // server -> client prompt : [udpPort(2)], exactly as old clients expect it
+    // client -> server reply  : [udpPort(2)][capabilities(4)] (old clients send only the port)
+    // server -> client accept : UDP_PORT [token(4)][capabilities(4)], sent only when the reply offered capabilities
+    constexpr std::uint32_t CAPABILITY_NONE = 0;
+    constexpr std::uint32_t CAPABILITY_UDP_TOKEN = 1u << 0;
+    constexpr std::uint32_t CAPABILITY_UDP_BUNDLE = 1u << 1;
+
+    // single round trip handshake, the client sends its hello right after connect without waiting for the prompt
+    // client -> server data : [udpPort(2)][capabilities(4)][usernameSize(2)][username][GroupDto], RpcPacket.uid = user id
+    // server -> client      : GROUP_INFO with the joined GroupDto once the session is in its group
+    // old servers read the hello as a plain UDP_PORT reply and keep prompting USER_INFO / GROUP_INFO
+    constexpr std::uint32_t CAPABILITY_PIPELINED_HANDSHAKE = 1u << 2;
+
+    constexpr std::uint32_t SERVER_CAPABILITIES = CAPABILITY_UDP_TOKEN | CAPABILITY_UDP_BUNDLE | CAPABILITY_PIPELINED_HANDSHAKE;
+}
@@ -6,25 +6,44 @@
 #include <spdlog/spdlog.h>
 
 #include <stduuid/uuid.h>
+#include <google/protobuf/arena.h>
 
 #include "NetworkData.pb.h"
 
 using uuids::uuid;
 using namespace NetworkData;
 
-static void MakeHitPacket(uuid attacker, uuid victim, std::shared_ptr<RpcPacket>& out, std::int32_t dmg)
+// one inbound rpc, shared by every stage from the receive path to the group tick
+struct SSendPacket
 {
-    RpcPacket hitPacket;
-    hitPacket.set_uid(uuids::to_string(victim));
-    hitPacket.set_method(RpcMethod::Hit);
+    std::size_t packetNumber;
+    uuid guid;
+    const RpcPacket* packet; // uid inclusive, lives in the same arena as this struct
+};
 
-    HitData hitData;
-    hitData.set_attacker(uuids::to_string(attacker));
-    hitData.set_dmg(dmg);
+// wrap a packet parsed into arena, the returned pointer keeps the arena alive
+static std::shared_ptr<SSendPacket> MakeInboundPacket(const std::shared_ptr<google::protobuf::Arena>& arena, const RpcPacket* packet, const uuid& guid)
+{
+    auto* input = google::protobuf::Arena::Create<SSendPacket>(arena.get());
+    input->packetNumber = 0;
+    input->guid = guid;
+    input->packet = packet;
+    return std::shared_ptr<SSendPacket>(arena, input);
+}
+
+// hit packet and its payload share one arena, released with the last reference to the packet
+static std::shared_ptr<SSendPacket> MakeHitPacket(uuid attacker, uuid victim, std::int32_t dmg)
+{
+    auto arena = std::make_shared<google::protobuf::Arena>();
+    auto* hitPacket = google::protobuf::Arena::Create<RpcPacket>(arena.get());
+    hitPacket->set_uid(uuids::to_string(victim));
+    hitPacket->set_method(RpcMethod::Hit);
+
+    auto* hitData = google::protobuf::Arena::Create<HitData>(arena.get());
+    hitData->set_attacker(uuids::to_string(attacker));
+    hitData->set_dmg(dmg);
 
-    std::string serializedHitData;
-    hitData.SerializeToString(&serializedHitData);
-    hitPacket.set_data(serializedHitData);
+    hitData->SerializeToString(hitPacket->mutable_data());
 
-    out = std::make_shared<RpcPacket>(hitPacket);
-}
\ No newline at end of file
+    return MakeInboundPacket(arena, hitPacket, victim);
+}
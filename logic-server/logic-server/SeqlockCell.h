@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// single writer, many readers : the writer never waits, a reader retries while a store is in progress
+// odd sequence = store in progress, the payload is kept in relaxed atomic words so a torn read is never a data race
+template <typename T>
+class SeqlockCell
+{
+    static_assert(std::is_trivially_copyable_v<T>, "SeqlockCell payload must be trivially copyable");
+
+public:
+    static constexpr std::size_t WORD_COUNT = (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+    SeqlockCell() = default;
+    explicit SeqlockCell(const T& value) { Store(value); }
+
+    SeqlockCell(const SeqlockCell&) = delete;
+    SeqlockCell& operator=(const SeqlockCell&) = delete;
+
+    // only one thread (or strand) may store
+    void Store(const T& value)
+    {
+        std::uint64_t words[WORD_COUNT] = {};
+        std::memcpy(words, &value, sizeof(T));
+
+        const auto sequence = _sequence.load(std::memory_order_relaxed);
+        _sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (std::size_t i = 0; i < WORD_COUNT; ++i)
+        {
+            _words[i].store(words[i], std::memory_order_relaxed);
+        }
+
+        _sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    T Load() const
+    {
+        std::uint64_t words[WORD_COUNT];
+        std::uint32_t before;
+        std::uint32_t after;
+        do
+        {
+            before = _sequence.load(std::memory_order_acquire);
+            for (std::size_t i = 0; i < WORD_COUNT; ++i)
+            {
+                words[i] = _words[i].load(std::memory_order_relaxed);
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = _sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) != 0 || before != after);
+
+        T value;
+        std::memcpy(&value, words, sizeof(T));
+        return value;
+    }
+
+private:
+    std::atomic<std::uint32_t> _sequence = 0;
+    std::atomic<std::uint64_t> _words[WORD_COUNT] = {};
+};
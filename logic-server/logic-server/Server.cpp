@@ -6,14 +6,97 @@
 
 Server::Server(const std::shared_ptr<ContextManager>& mainCtxManager, const std::shared_ptr<ContextManager>& rpcCtxManager, tcp::acceptor& acceptor)
     : _normalCtxManager(mainCtxManager), _rpcCtxManager(rpcCtxManager), _acceptor(acceptor),
-    _normalPrivateStrand(_normalCtxManager->GetContext()), _rpcPrivateStrand(_rpcCtxManager->GetContext()),
-    _udpSocket(std::make_shared<UdpSocket>(_rpcCtxManager->GetContext(), udp::endpoint(udp::v4(), 0)))
+    _normalPrivateStrand(_normalCtxManager->GetContext())
 {
     _groupManager = std::make_shared<GroupManager>(_normalCtxManager);
     _isRunning = false;
-    _isSending = false;
-    _allocatedUdpPort = _udpSocket->local_endpoint().port();
-    spdlog::info("allocated udp port: {}", _allocatedUdpPort);
+
+    // one shard per rpc io thread, the kernel spreads client flows over the shards
+    std::size_t shardCount = 1;
+#if defined(__linux__)
+    if (_useReusePortSharding)
+        shardCount = std::max<std::size_t>(1, _rpcCtxManager->GetThreadCount());
+#else
+    if (_useReusePortSharding)
+        spdlog::warn("SO_REUSEPORT is not supported on this platform, udp runs on a single socket");
+#endif
+
+    // first socket allocates the port, the rest join it
+    const bool reusePort = shardCount > 1;
+    auto firstSocket = OpenUdpSocket(0, reusePort);
+    _allocatedUdpPort = firstSocket->local_endpoint().port();
+
+    // receive slots per wakeup, one arena block covers a full wakeup
+    const std::size_t receiveSlotCount = _useBatchedUdpReceive ? _udpBatchSize : 1;
+    const std::size_t arenaBlockSize = receiveSlotCount * _arenaBytesPerDatagram;
+
+    _udpShards.reserve(shardCount);
+    _udpShards.push_back(std::make_shared<SUdpShard>(0, firstSocket, _rpcCtxManager->GetContext(), _udpSendRingCapacity, _arenaPoolSizePerShard, arenaBlockSize));
+    for (std::size_t i = 1; i < shardCount; ++i)
+    {
+        _udpShards.push_back(std::make_shared<SUdpShard>(i, OpenUdpSocket(_allocatedUdpPort, reusePort), _rpcCtxManager->GetContext(), _udpSendRingCapacity, _arenaPoolSizePerShard, arenaBlockSize));
+    }
+
+    spdlog::info("allocated udp port: {} ({} shards)", _allocatedUdpPort, shardCount);
+
+    for (const auto& shard : _udpShards)
+    {
+        _sessions.RegisterReader(shard->directoryReader);
+        shard->unroutedOverflowBucket.Configure(_udpUnroutedOverflowRatePerShard, _udpUnroutedOverflowBurstPerShard);
+
+        // receive slots live as long as the shard, every wakeup reuses them
+        shard->receiveStorage.resize(receiveSlotCount * _maxPacketSize);
+        shard->batchBuffers.reserve(receiveSlotCount);
+        for (std::size_t i = 0; i < receiveSlotCount; ++i)
+        {
+            shard->batchBuffers.push_back(shard->receiveStorage.data() + i * _maxPacketSize);
+        }
+    }
+
+    if (_useBatchedUdpReceive)
+    {
+        for (const auto& shard : _udpShards)
+        {
+            shard->batchEndpoints.resize(_udpBatchSize);
+            shard->batchBytes.resize(_udpBatchSize);
+
+#if defined(__linux__)
+            shard->batchHeaders.resize(_udpBatchSize);
+            shard->batchIovecs.resize(_udpBatchSize);
+#endif
+
+            shard->socket->non_blocking(true);
+        }
+    }
+
+    if (_useBatchedUdpSend)
+    {
+        for (const auto& shard : _udpShards)
+        {
+            shard->sendBatch.reserve(_udpSendBatchSize);
+
+#if defined(__linux__)
+            shard->sendHeaders.resize(_udpSendBatchSize);
+            shard->sendIovecs.resize(_udpSendBatchSize * 2);
+            shard->sendControls.resize(_udpSendBatchSize * CMSG_SPACE(sizeof(std::uint16_t)));
+            shard->sendHeaderFirstSlots.resize(_udpSendBatchSize);
+#endif
+
+            shard->socket->non_blocking(true);
+        }
+    }
+
+#if defined(__linux__)
+    if (_useBatchedUdpSend && _useUdpGso)
+    {
+        // probe : kernels without UDP_SEGMENT reject the option
+        int segmentSize = 0;
+        if (::setsockopt(_udpShards.front()->socket->native_handle(), SOL_UDP, UDP_SEGMENT, &segmentSize, sizeof(segmentSize)) == 0)
+            _isUdpGsoEnabled = true;
+        else
+            spdlog::warn("udp gso is not supported, falling back to sendmmsg ({})", std::strerror(errno));
+    }
+#endif
 }
 
 Server::~Server()
@@ -25,7 +108,14 @@ void Server::Start()
 {
     _isRunning = true;
     AcceptClientAsync();
-    AsyncReceiveUdpData();
+
+    for (const auto& shard : _udpShards)
+    {
+        if (_useBatchedUdpReceive)
+            AsyncReceiveUdpBatch(shard);
+        else
+            AsyncReceiveUdpData(shard);
+    }
 
     spdlog::info("server start complete");
 }
@@ -35,7 +125,10 @@ void Server::Stop(bool forceStop)
     spdlog::info("server stopping...");
 
     _isRunning = false;
-    _udpSocket->close();
+    for (const auto& shard : _udpShards)
+    {
+        shard->socket->close();
+    }
 
     _acceptor.close();
 
@@ -52,10 +145,10 @@ void Server::AcceptClientAsync()
 
     auto weak(weak_from_this());
     auto newSession = std::make_shared<Session>(_normalCtxManager, _rpcCtxManager);
-    newSession->SetSendDataByUdpAction([weak](std::shared_ptr<std::pair<udp::endpoint, std::string>> sendData)
+    newSession->SetSendDataByUdpAction([weak](SUdpSendData sendData)
     {
         if (auto self = weak.lock())
-            self->EnqueueSendData(sendData);
+            self->EnqueueSendData(std::move(sendData));
     });
 
     auto self(shared_from_this());
@@ -83,169 +176,411 @@ void Server::AcceptClientAsync()
 void Server::InitSessionNetwork(const std::shared_ptr<Session>& newSession)
 {
     auto self(shared_from_this());
-    newSession->AsyncExchangeUdpPortWork(_allocatedUdpPort, [self, newSession](bool success)
+
+    // token slot is reserved now and starts resolving once the session is added
+    newSession->SetUdpToken(_sessions.IssueToken());
+    newSession->SetUdpIngressLimit(_udpIngressRatePerSession, _udpIngressBurstPerSession);
+
+    newSession->AsyncHandshake(_allocatedUdpPort, [self, newSession](bool success, std::shared_ptr<GroupDto> groupInfo)
     {
         if (!success)
         {
-            spdlog::error("new session failed to excahnge UDP port");
+            spdlog::error("new session failed to handshake");
+            self->_sessions.ReleaseToken(newSession->GetUdpToken());
             newSession->Stop(false);
-            return;
+            return false;
+        }
+
+        spdlog::info("group {} set session {}", groupInfo->groupid(), uuids::to_string(newSession->GetSessionUuid()));
+        if (!self->_groupManager->AddSession(groupInfo, newSession))
+        {
+            spdlog::error("session {} refused by group {}", uuids::to_string(newSession->GetSessionUuid()), groupInfo->groupid());
+            self->_sessions.ReleaseToken(newSession->GetUdpToken());
+            newSession->Stop(false);
+            return false;
         }
 
-        // User info and group info
-        newSession->AsyncReceiveUserInfo([self, newSession](bool success)
+        self->AddSession(newSession);
+
+        std::weak_ptr<Server> weak(self);
+        newSession->SetStopCallbackByServer([weak](const std::shared_ptr<Session>& session)
+        {
+            if (auto self = weak.lock())
+                self->RemoveSession(session->GetSessionUuid());
+        });
+
+        return true;
+    });
+}
+
+std::shared_ptr<udp::socket> Server::OpenUdpSocket(std::uint16_t port, bool reusePort)
+{
+    auto socket = std::make_shared<UdpSocket>(_rpcCtxManager->GetContext());
+    socket->open(udp::v4());
+
+#if defined(__linux__)
+    if (reusePort)
+        socket->set_option(asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(true));
+#endif
+
+    socket->bind(udp::endpoint(udp::v4(), port));
+    return socket;
+}
+
+void Server::AsyncReceiveUdpData(UdpShardPtr shard)
+{
+    auto self(shared_from_this());
+
+    // only one receive is in flight per shard, so its single slot is free again once the datagram is parsed
+    shard->socket->async_receive_from(asio::buffer(shard->batchBuffers.front(), self->_maxPacketSize), shard->receiveEndpoint,
+        asio::bind_executor(shard->strand, [self, shard](const std::error_code ec, const std::size_t bytesRead)
+    {
+        if (ec)
         {
-            if (!success)
+            if (ec == asio::error::operation_aborted)
             {
-                spdlog::error("new session failed to exchange user info");
-                newSession->Stop(false);
+                spdlog::info("main server udp receive_from closed (shard {})", shard->index);
                 return;
             }
 
-            newSession->AsyncReceiveGroupInfo([self, newSession](bool success, std::shared_ptr<GroupDto> groupInfo)
-            {
-                if (!success)
-                {
-                    spdlog::error("new session failed to exchange user info");
-                    newSession->Stop(false);
-                    return;
-                }
-
-                spdlog::info("group {} set session {}", groupInfo->groupid(), uuids::to_string(newSession->GetSessionUuid()));
-                self->_groupManager->AddSession(groupInfo, newSession);
-                self->AddSession(newSession);
+            spdlog::error("udp read error on {} : {}", shard->receiveEndpoint.address().to_string(), ec.message());
+            asio::post(shard->strand, [self, shard]() { self->AsyncReceiveUdpData(shard); });
+            return;
+        }
 
-                std::weak_ptr<Server> weak(self);
-                newSession->SetStopCallbackByServer([weak](const std::shared_ptr<Session>& session)
-                {
-                    if (auto self = weak.lock())
-                        self->RemoveSession(session->GetSessionUuid());
-                });
-            });
-        });
-    });
+        {
+            SessionDirectory::ReadGuard directoryGuard(self->_sessions, shard->directoryReader);
+            self->ProcessUdpDatagram(*shard, shard->arenaPool.Acquire(), shard->batchBuffers.front(), bytesRead, shard->receiveEndpoint);
+        }
+        asio::post(shard->strand, [self, shard]() { self->AsyncReceiveUdpData(shard); });
+    }));
 }
 
-void Server::AsyncReceiveUdpData()
+// wait until the socket is readable, then drain every queued datagram (up to _udpBatchSize) at once
+void Server::AsyncReceiveUdpBatch(UdpShardPtr shard)
 {
     auto self(shared_from_this());
-    auto receiveBuffer = std::make_shared<std::vector<char>>(_maxPacketSize);
-    auto senderEndPoint = std::make_shared<udp::endpoint>();
-    _udpSocket->async_receive_from(asio::buffer(*receiveBuffer), *senderEndPoint,
-        asio::bind_executor(_rpcPrivateStrand, [self, receiveBuffer, senderEndPoint](const std::error_code ec, const std::size_t bytesRead)
+    shard->socket->async_wait(UdpSocket::wait_read,
+        asio::bind_executor(shard->strand, [self, shard](const std::error_code ec)
     {
         if (ec)
         {
             if (ec == asio::error::operation_aborted)
             {
-                spdlog::info("main server udp receive_from closed");
+                spdlog::info("main server udp batch receive closed (shard {})", shard->index);
                 return;
             }
 
-            spdlog::error("udp read error on {} : {}", senderEndPoint->address().to_string(), ec.message());
-            asio::post(self->_rpcPrivateStrand, [self]() { self->AsyncReceiveUdpData(); });
+            spdlog::error("udp wait error : {}", ec.message());
+            asio::post(shard->strand, [self, shard]() { self->AsyncReceiveUdpBatch(shard); });
             return;
         }
 
-        if (bytesRead < sizeof(std::uint16_t))
+        const std::size_t receivedCount = self->ReceiveUdpBatch(*shard);
+        if (receivedCount == 0)
         {
-            spdlog::error("udp read bytes error on {} : {}", senderEndPoint->address().to_string(), ec.message());
-            asio::post(self->_rpcPrivateStrand, [self]() { self->AsyncReceiveUdpData(); });
+            asio::post(shard->strand, [self, shard]() { self->AsyncReceiveUdpBatch(shard); });
             return;
         }
 
-        ConsoleMonitor::Get().IncrementUdpPacket();
+        // the whole batch shares one arena
+        const auto batchArena = shard->arenaPool.Acquire();
+        SessionDirectory::ReadGuard directoryGuard(self->_sessions, shard->directoryReader);
+        for (std::size_t i = 0; i < receivedCount; ++i)
+        {
+            self->ProcessUdpDatagram(*shard, batchArena, shard->batchBuffers[i], shard->batchBytes[i], shard->batchEndpoints[i]);
+        }
+
+        asio::post(shard->strand, [self, shard]() { self->AsyncReceiveUdpBatch(shard); });
+    }));
+}
+
+// non-blocking drain into the preallocated batch slots, returns received datagram count
+std::size_t Server::ReceiveUdpBatch(SUdpShard& shard)
+{
+#if defined(__linux__)
+    // one recvmmsg syscall for the whole batch
+    for (std::size_t i = 0; i < _udpBatchSize; ++i)
+    {
+        shard.batchIovecs[i].iov_base = shard.batchBuffers[i];
+        shard.batchIovecs[i].iov_len = _maxPacketSize;
+
+        auto& header = shard.batchHeaders[i].msg_hdr;
+        header = {};
+        header.msg_name = shard.batchEndpoints[i].data();
+        header.msg_namelen = static_cast<socklen_t>(shard.batchEndpoints[i].capacity());
+        header.msg_iov = &shard.batchIovecs[i];
+        header.msg_iovlen = 1;
+        shard.batchHeaders[i].msg_len = 0;
+    }
+
+    const int result = ::recvmmsg(shard.socket->native_handle(), shard.batchHeaders.data(), static_cast<unsigned int>(_udpBatchSize), MSG_DONTWAIT, nullptr);
+    if (result < 0)
+    {
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            spdlog::error("udp recvmmsg error : {}", std::strerror(errno));
+        return 0;
+    }
 
-        std::uint16_t payloadSize;
-        std::memcpy(&payloadSize, receiveBuffer->data(), sizeof(std::uint16_t));
-        payloadSize = ntohs(payloadSize);
+    const auto receivedCount = static_cast<std::size_t>(result);
+    for (std::size_t i = 0; i < receivedCount; ++i)
+    {
+        shard.batchEndpoints[i].resize(shard.batchHeaders[i].msg_hdr.msg_namelen);
+        shard.batchBytes[i] = shard.batchHeaders[i].msg_len;
+    }
 
-        if (payloadSize == 0 || payloadSize + sizeof(std::uint16_t) > bytesRead)
+    return receivedCount;
+#else
+    // portable fallback: one non-blocking receive per slot until the socket would block
+    std::size_t receivedCount = 0;
+    while (receivedCount < _udpBatchSize)
+    {
+        std::error_code ec;
+        const std::size_t bytesRead = shard.socket->receive_from(asio::buffer(shard.batchBuffers[receivedCount], _maxPacketSize), shard.batchEndpoints[receivedCount], 0, ec);
+        if (ec)
         {
-            spdlog::error("udp read nothing or over payload size from {}", senderEndPoint->address().to_string());
-            asio::post(self->_rpcPrivateStrand, [self]() { self->AsyncReceiveUdpData(); });
-            return;
+            if (ec != asio::error::would_block)
+                spdlog::error("udp batch read error on {} : {}", shard.batchEndpoints[receivedCount].address().to_string(), ec.message());
+            break;
         }
 
-        RpcPacket receivedRpcPacket;
-        if (!receivedRpcPacket.ParseFromArray(receiveBuffer->data() + sizeof(std::uint16_t), payloadSize))
+        shard.batchBytes[receivedCount] = bytesRead;
+        ++receivedCount;
+    }
+
+    return receivedCount;
+#endif
+}
+
+// parse one datagram ([size(2)][RpcPacket]) and dispatch it to the owner session
+void Server::ProcessUdpDatagram(SUdpShard& shard, const std::shared_ptr<google::protobuf::Arena>& arena, const char* data, std::size_t bytesRead, const udp::endpoint& senderEndPoint)
+{
+    ConsoleMonitor::Get().IncrementUdpPacket();
+    const auto now = TokenBucket::Clock::now();
+
+    // malformed datagrams are charged to the sender endpoint before they are rejected
+    auto rejectUnrouted = [this, &shard, &senderEndPoint, now](std::string_view reason)
+    {
+        if (!TryConsumeUnroutedIngress(shard, senderEndPoint, now))
         {
-            spdlog::error("rpc packet parsing error from {}", senderEndPoint->address().to_string());
-            asio::post(self->_rpcPrivateStrand, [self]() { self->AsyncReceiveUdpData(); });
+            ConsoleMonitor::Get().IncrementUdpRateLimited();
             return;
         }
 
-        // valid data collected to session and lockstep group
-        auto id = uuids::uuid::from_string(receivedRpcPacket.uid());
-        if (!id) {
-             spdlog::error("invalid session id requested (id: {})", receivedRpcPacket.uid());
-             asio::post(self->_rpcPrivateStrand, [self]() { self->AsyncReceiveUdpData(); });
-             return;
+        DropUdpDatagram(shard, senderEndPoint, reason, now);
+    };
+
+    if (bytesRead < sizeof(std::uint16_t))
+    {
+        rejectUnrouted("short datagram");
+        return;
+    }
+
+    std::uint16_t sizeHeader;
+    std::memcpy(&sizeHeader, data, sizeof(std::uint16_t));
+    sizeHeader = ntohs(sizeHeader);
+
+    const bool hasToken = (sizeHeader & NetworkProtocol::UDP_TOKEN_FLAG) != 0;
+    const std::size_t headerSize = sizeof(std::uint16_t) + (hasToken ? sizeof(std::uint32_t) : 0);
+    const std::uint16_t payloadSize = hasToken ? (sizeHeader & NetworkProtocol::UDP_SIZE_MASK) : sizeHeader;
+
+    if (payloadSize == 0 || payloadSize + headerSize > bytesRead)
+    {
+        rejectUnrouted("empty or over payload size");
+        return;
+    }
+
+    std::uint32_t token = NetworkProtocol::INVALID_SESSION_TOKEN;
+    if (hasToken)
+    {
+        std::memcpy(&token, data + sizeof(std::uint16_t), sizeof(token));
+        token = ntohl(token);
+    }
+
+    // 1. known endpoint : owner resolved before any parsing
+    // 2. token datagram : owner resolved by direct slot index
+    Session* session = _sessions.FindByEndpoint(shard.directoryReader, senderEndPoint);
+    if (session != nullptr && hasToken && session->GetUdpToken() != token)
+        session = nullptr;
+
+    if (session == nullptr && hasToken)
+    {
+        session = _sessions.FindByToken(token);
+        if (session == nullptr)
+        {
+            rejectUnrouted("invalid session token");
+            return;
         }
+    }
 
-        std::lock_guard<std::mutex> sessionsLock(self->_sessionsMutex);
-        auto sessionIt = self->_sessions.find(*id);
-        if (sessionIt == self->_sessions.end())
+    if (session == nullptr && _dropUnknownUdpEndpoint)
+    {
+        ConsoleMonitor::Get().IncrementUdpDropped();
+        return;
+    }
+
+    // rate limit before parsing, a flooding client only spends its own budget
+    const bool isAllowed = session != nullptr ? session->TryConsumeUdpIngress(now) : TryConsumeUnroutedIngress(shard, senderEndPoint, now);
+    if (!isAllowed)
+    {
+        ConsoleMonitor::Get().IncrementUdpRateLimited();
+        return;
+    }
+
+    // parsed packet and its strings live in the arena, the shared_ptr keeps the arena alive
+    auto* receivedRpcPacket = google::protobuf::Arena::Create<RpcPacket>(arena.get());
+    if (!receivedRpcPacket->ParseFromArray(data + headerSize, payloadSize))
+    {
+        DropUdpDatagram(shard, senderEndPoint, "rpc packet parsing error", now);
+        return;
+    }
+
+    if (session != nullptr)
+    {
+        // legacy datagram from a known endpoint : uid is only checked by sampling
+        // a mismatch means the endpoint is shared, it is no longer trusted for any session
+        if (!hasToken && ++shard.uidVerifyCounter % _uidVerifySampleRate == 0 && receivedRpcPacket->uid() != session->GetSessionUid())
         {
-            spdlog::error("invalid session id requested (id: {})", receivedRpcPacket.uid());
-            asio::post(self->_rpcPrivateStrand, [self]() { self->AsyncReceiveUdpData(); });
+            spdlog::error("uid mismatch from {} (endpoint owner: {}, requested: {})", senderEndPoint.address().to_string(), session->GetSessionUid(), receivedRpcPacket->uid());
+            ConsoleMonitor::Get().IncrementUdpDropped();
+            _sessions.ContestEndpoint(senderEndPoint);
             return;
         }
 
-        sessionIt->second->CollectInput(std::make_shared<RpcPacket>(receivedRpcPacket));
-        asio::post(self->_rpcPrivateStrand, [self]() { self->AsyncReceiveUdpData(); });
-    }));
+        // the resolved owner identifies the sender, uid is filled for the group and the other clients
+        receivedRpcPacket->set_uid(session->GetSessionUid());
+        session->CollectInput(MakeInboundPacket(arena, receivedRpcPacket, session->GetSessionUuid()));
+        return;
+    }
+
+    // valid data collected to session and lockstep group
+    // sessions are shared by every shard, so the owner is found whichever socket received the datagram
+    auto id = uuids::uuid::from_string(receivedRpcPacket->uid());
+    if (!id) {
+         DropUdpDatagram(shard, senderEndPoint, "invalid session id", now);
+         return;
+    }
+
+    session = _sessions.Find(shard.directoryReader, *id);
+    if (session == nullptr)
+    {
+        DropUdpDatagram(shard, senderEndPoint, "unknown session id", now);
+        return;
+    }
+
+    // the owner's own budget also covers datagrams from its unknown endpoints
+    if (!session->TryConsumeUdpIngress(now))
+    {
+        ConsoleMonitor::Get().IncrementUdpRateLimited();
+        return;
+    }
+
+    // uid datagram from the session's own tcp peer address : the endpoint routes its next datagrams before parsing
+    if (senderEndPoint.address() == session->GetUdpEndpoint().address())
+        _sessions.LearnEndpoint(shard.directoryReader, senderEndPoint, session);
+
+    session->CollectInput(MakeInboundPacket(arena, receivedRpcPacket, *id));
+}
+
+// shard strand only, every drop is counted but at most one line per _udpDropLogInterval is logged
+void Server::DropUdpDatagram(SUdpShard& shard, const udp::endpoint& senderEndPoint, std::string_view reason, TokenBucket::Clock::time_point now)
+{
+    ConsoleMonitor::Get().IncrementUdpDropped();
+
+    ++shard.unloggedDropCount;
+    if (now - shard.lastDropLog < _udpDropLogInterval)
+        return;
+
+    spdlog::error("udp datagram dropped from {} : {} ({} dropped since the last report)", senderEndPoint.address().to_string(), reason, shard.unloggedDropCount);
+    shard.unloggedDropCount = 0;
+    shard.lastDropLog = now;
+}
+
+// shard strand only
+bool Server::TryConsumeUnroutedIngress(SUdpShard& shard, const udp::endpoint& senderEndPoint, TokenBucket::Clock::time_point now)
+{
+    auto it = shard.unroutedSenders.find(senderEndPoint);
+    if (it == shard.unroutedSenders.end())
+    {
+        // full : drop idle senders, at most once per timeout so a spoofing flood does not sweep on every datagram
+        if (shard.unroutedSenders.size() >= _udpUnroutedEndpointLimit && now - shard.lastUnroutedSweep >= _udpUnroutedIdleTimeout)
+        {
+            shard.lastUnroutedSweep = now;
+            std::erase_if(shard.unroutedSenders, [this, now](const auto& entry) { return now - entry.second.lastSeen >= _udpUnroutedIdleTimeout; });
+        }
+
+        if (shard.unroutedSenders.size() >= _udpUnroutedEndpointLimit)
+            return shard.unroutedOverflowBucket.TryConsume(now);
+
+        auto bucket = std::make_unique<TokenBucket>(_udpUnroutedRatePerEndpoint, _udpUnroutedBurstPerEndpoint);
+        it = shard.unroutedSenders.emplace(senderEndPoint, SUdpShard::SUnroutedSender{ std::move(bucket), now }).first;
+    }
+
+    it->second.lastSeen = now;
+    return it->second.bucket->TryConsume(now);
 }
 
-void Server::EnqueueSendData(std::shared_ptr<std::pair<udp::endpoint, std::string>> sendDataPair)
+void Server::EnqueueSendData(SUdpSendData sendData)
 {
-    std::lock_guard<std::mutex> lock(_sendDataQueueMutex);
-    _sendDataQueue.push(sendDataPair);
-    if (!_isSending)
+    // a client always goes out through the same shard to keep its datagrams in order
+    const auto& endpoint = sendData.endpoint;
+    const std::size_t endpointKey = (static_cast<std::size_t>(endpoint.address().to_v4().to_uint()) << 16) ^ endpoint.port();
+    const auto& shard = _udpShards[endpointKey % _udpShards.size()];
+
+    std::size_t retryCount = 0;
+    const bool isPushed = shard->sendRing.TryPush(std::move(sendData), retryCount);
+
+    auto& monitor = ConsoleMonitor::Get();
+    if (retryCount > 0)
+        monitor.IncrementUdpEgressRetry(retryCount);
+
+    if (!isPushed)
+    {
+        monitor.IncrementUdpEgressFull();
+        return;
+    }
+
+    monitor.UpdateUdpEgressDepth(shard->sendRing.Size());
+
+    // published before the flag is checked : either we wake the consumer or it sees our datagram after clearing the flag
+    // the ring push is only a relaxed CAS and a release store, the fence orders it before the flag (store-buffering)
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!shard->isSending.exchange(true))
     {
-        _isSending = true;
         auto self(shared_from_this());
-        asio::post(_rpcPrivateStrand, [self]() { self->AsyncSendUdpData(); });
+        asio::post(shard->strand, [self, shard]() { self->AsyncSendUdpData(shard); });
     }
 }
 
-void Server::AsyncSendUdpData()
+void Server::AsyncSendUdpData(UdpShardPtr shard)
 {
     auto self(shared_from_this());
-    asio::post(_rpcPrivateStrand, [self]() 
+    asio::post(shard->strand, [self, shard]()
     {
-        std::queue<std::shared_ptr<std::pair<udp::endpoint, std::string>>> localQueue;
+        std::queue<SUdpSendData> localQueue;
 
+        // at most one ring worth per round, producers that keep pushing are served by the next post
+        SUdpSendData sendData;
+        while (localQueue.size() < shard->sendRing.Capacity() && shard->sendRing.TryPop(sendData))
         {
-            std::lock_guard<std::mutex> lock(self->_sendDataQueueMutex);
-            if (self->_sendDataQueue.empty())
-            {
-                self->_isSending = false;
-                return;
-            }
-
-            self->_sendDataQueue.swap(localQueue);
+            localQueue.push(std::move(sendData));
         }
 
+        // whatever the batch could not flush (socket buffer full) goes out asynchronously below
+        if (self->_useBatchedUdpSend)
+            self->SendUdpBatch(*shard, localQueue);
+
         while (!localQueue.empty())
         {
-            auto sendDataPair = localQueue.front();
+            auto sendData = std::move(localQueue.front());
             localQueue.pop();
 
-            // Lock is released here as the queue has been modified.
-            // Prepare and send data outside the lock scope.
-            udp::endpoint ep = sendDataPair->first;
-            std::string sendData = sendDataPair->second;
+            // prefix and payload are sent straight from the shared frame
+            const auto frame = std::move(sendData.frame);
 
-            const std::uint16_t payloadSize = static_cast<std::uint16_t>(sendData.size());
-            const std::uint16_t payloadNetSize = htons(payloadSize);
-
-            const auto payload = std::make_shared<std::string>();
-            payload->append(reinterpret_cast<const char*>(&payloadNetSize), sizeof(payloadNetSize));
-            payload->append(sendData);
-
-            self->_udpSocket->async_send_to(asio::buffer(*payload), ep,
-                asio::bind_executor(self->_rpcPrivateStrand, [self, payload, ep](std::error_code ec, std::size_t)
+            ConsoleMonitor::Get().IncrementUdpSendSyscall();
+            shard->socket->async_send_to(frame->Buffers(), sendData.endpoint,
+                asio::bind_executor(shard->strand, [self, frame](std::error_code ec, std::size_t)
             {
                 if (ec)
                 {
@@ -254,28 +589,174 @@ void Server::AsyncSendUdpData()
             }));
         }
 
-        std::lock_guard<std::mutex> lock(self->_sendDataQueueMutex);
-        if (!self->_sendDataQueue.empty())
+        // clear the flag first, then look again so a producer racing with us is never left unsent
+        shard->isSending.store(false);
+        std::atomic_thread_fence(std::memory_order_seq_cst); // pairs with the producer fence
+        if (!shard->sendRing.Empty() && !shard->isSending.exchange(true))
+        {
+            asio::post(shard->strand, [self, shard]() { self->AsyncSendUdpData(shard); });
+        }
+    });
+}
+
+// non-blocking flush of the drained send queue, unsent datagrams are left in sendQueue in order
+void Server::SendUdpBatch(SUdpShard& shard, std::queue<SUdpSendData>& sendQueue)
+{
+    auto& batch = shard.sendBatch;
+
+    while (!sendQueue.empty())
+    {
+        batch.clear();
+        while (!sendQueue.empty() && batch.size() < _udpSendBatchSize)
+        {
+            batch.push_back(std::move(sendQueue.front()));
+            sendQueue.pop();
+        }
+
+        std::size_t sentCount = 0;
+
+#if defined(__linux__)
+        // one sendmmsg syscall for the whole chunk, each datagram gathered from [prefix, payload]
+        // with gso, a run of datagrams to one endpoint (all full size but the last) goes in one header
+        const bool useGso = _isUdpGsoEnabled.load(std::memory_order_relaxed);
+        const std::size_t controlSize = CMSG_SPACE(sizeof(std::uint16_t));
+        std::size_t headerCount = 0;
+        std::size_t iovecCount = 0;
+        for (std::size_t first = 0; first < batch.size(); ++headerCount)
+        {
+            const std::size_t segmentSize = batch[first].frame->Size();
+            std::size_t last = first + 1;
+            if (useGso)
+            {
+                std::size_t runBytes = segmentSize;
+                while (last < batch.size()
+                    && last - first < _udpGsoMaxSegments
+                    && batch[last].endpoint == batch[first].endpoint
+                    && batch[last - 1].frame->Size() == segmentSize
+                    && batch[last].frame->Size() <= segmentSize
+                    && runBytes + batch[last].frame->Size() <= _udpGsoMaxBytes)
+                {
+                    runBytes += batch[last].frame->Size();
+                    ++last;
+                }
+            }
+
+            iovec* iovecs = &shard.sendIovecs[iovecCount];
+            for (std::size_t i = first; i < last; ++i)
+            {
+                for (const auto& buffer : batch[i].frame->Buffers())
+                {
+                    shard.sendIovecs[iovecCount].iov_base = const_cast<void*>(buffer.data());
+                    shard.sendIovecs[iovecCount].iov_len = buffer.size();
+                    ++iovecCount;
+                }
+            }
+
+            auto& header = shard.sendHeaders[headerCount].msg_hdr;
+            header = {};
+            header.msg_name = batch[first].endpoint.data();
+            header.msg_namelen = static_cast<socklen_t>(batch[first].endpoint.size());
+            header.msg_iov = iovecs;
+            header.msg_iovlen = &shard.sendIovecs[iovecCount] - iovecs;
+            shard.sendHeaders[headerCount].msg_len = 0;
+            shard.sendHeaderFirstSlots[headerCount] = first;
+
+            if (last - first > 1)
+            {
+                header.msg_control = &shard.sendControls[headerCount * controlSize];
+                header.msg_controllen = controlSize;
+
+                cmsghdr* control = CMSG_FIRSTHDR(&header);
+                control->cmsg_level = SOL_UDP;
+                control->cmsg_type = UDP_SEGMENT;
+                control->cmsg_len = CMSG_LEN(sizeof(std::uint16_t));
+
+                const auto gsoSize = static_cast<std::uint16_t>(segmentSize);
+                std::memcpy(CMSG_DATA(control), &gsoSize, sizeof(gsoSize));
+            }
+
+            first = last;
+        }
+
+        bool isGsoRejected = false;
+        ConsoleMonitor::Get().IncrementUdpSendSyscall();
+        const int result = ::sendmmsg(shard.socket->native_handle(), shard.sendHeaders.data(), static_cast<unsigned int>(headerCount), MSG_DONTWAIT);
+        if (result < 0)
+        {
+            if (useGso && (errno == EIO || errno == EINVAL || errno == EOPNOTSUPP))
+            {
+                // device without checksum offload or an old kernel : resend the chunk without gso
+                spdlog::warn("udp gso rejected, falling back to sendmmsg ({})", std::strerror(errno));
+                _isUdpGsoEnabled = false;
+                isGsoRejected = true;
+            }
+            else if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                spdlog::error("udp sendmmsg error : {}", std::strerror(errno));
+            }
+        }
+        else
+        {
+            const auto sentHeaders = static_cast<std::size_t>(result);
+            sentCount = sentHeaders < headerCount ? shard.sendHeaderFirstSlots[sentHeaders] : batch.size();
+        }
+#else
+        // portable fallback: one non-blocking send per datagram until the socket would block
+        while (sentCount < batch.size())
+        {
+            std::error_code ec;
+            ConsoleMonitor::Get().IncrementUdpSendSyscall();
+            shard.socket->send_to(batch[sentCount].frame->Buffers(), batch[sentCount].endpoint, 0, ec);
+            if (ec)
+            {
+                if (ec != asio::error::would_block)
+                    spdlog::error("udp batch send error : {}", ec.message());
+                break;
+            }
+
+            ++sentCount;
+        }
+#endif
+
+        if (sentCount < batch.size())
         {
-            asio::post(self->_rpcPrivateStrand, [self]() { self->AsyncSendUdpData(); });
+            // put the unsent tail back in front of the not yet batched datagrams
+            std::queue<SUdpSendData> remainQueue;
+            for (std::size_t i = sentCount; i < batch.size(); ++i)
+            {
+                remainQueue.push(std::move(batch[i]));
+            }
+
+            while (!sendQueue.empty())
+            {
+                remainQueue.push(std::move(sendQueue.front()));
+                sendQueue.pop();
+            }
+
+            sendQueue.swap(remainQueue);
+            batch.clear();
+
+#if defined(__linux__)
+            if (isGsoRejected)
+                continue;
+#endif
             return;
         }
+    }
 
-        self->_isSending = false;
-    });
+    // drop the frame references of the last chunk
+    batch.clear();
 }
 
 void Server::AddSession(std::shared_ptr<Session> newSession)
 {
-    std::lock_guard<std::mutex> lock(_sessionsMutex);
-    _sessions[newSession->GetSessionUuid()] = newSession;
-    ConsoleMonitor::Get().UpdateClientCount((int)_sessions.size());
+    const std::size_t sessionCount = _sessions.Add(newSession);
+    ConsoleMonitor::Get().UpdateClientCount((int)sessionCount);
 }
 
 void Server::RemoveSession(uuid sessionId)
 {
-    std::lock_guard<std::mutex> lock(_sessionsMutex);
-    _sessions.erase(sessionId);
-    ConsoleMonitor::Get().UpdateClientCount((int)_sessions.size());
+    const std::size_t sessionCount = _sessions.Remove(sessionId);
+    ConsoleMonitor::Get().UpdateClientCount((int)sessionCount);
 	spdlog::info("Session {} removed from server session map", uuids::to_string(sessionId));
 }
\ No newline at end of file
@@ -3,12 +3,14 @@
 #include <stduuid/uuid.h>
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/basic_file_sink.h>
+#include <google/protobuf/arena.h>
 
 #include <mutex>
 #include <memory>
 #include <vector>
 #include <functional>
 #include <queue>
+#include <string_view>
 #include <unordered_map>
 
 #include "Base.h"
@@ -16,6 +18,23 @@
 #include "Util.h"
 #include "NetworkData.pb.h"
 #include "ContextManager.h"
+#include "ArenaPool.h"
+#include "SessionDirectory.h"
+#include "NetworkProtocol.h"
+#include "TokenBucket.h"
+#include "UdpFrame.h"
+#include "MpscRing.h"
+
+#if defined(__linux__)
+#include <sys/socket.h>
+#include <netinet/udp.h>
+#include <cerrno>
+#include <cstring>
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103 // linux 4.18+, older libc headers do not define it
+#endif
+#endif
 
 using IoContext = asio::io_context;
 using namespace asio::ip;
@@ -25,6 +44,75 @@ using uuids::uuid;
 class Session;
 class LockstepGroup;
 
+// one SO_REUSEPORT socket of the shared udp port with its own receive loop and send queue
+struct SUdpShard
+{
+    SUdpShard(std::size_t shardIndex, std::shared_ptr<udp::socket> udpSocket, asio::io_context& ctx, std::size_t sendRingCapacity, std::size_t arenaCount, std::size_t arenaBlockSize)
+        : index(shardIndex), socket(std::move(udpSocket)), strand(ctx), arenaPool(arenaCount, arenaBlockSize), sendRing(sendRingCapacity)
+    {
+    }
+
+    std::size_t index;
+    std::shared_ptr<udp::socket> socket;
+    asio::io_context::strand strand;
+
+    // single datagram receive
+    udp::endpoint receiveEndpoint;
+
+    // receive slots, carved once out of receiveStorage (one slot in single datagram mode)
+    // a slot is reused as soon as its datagram is parsed, packets live in the arenas
+    std::vector<char> receiveStorage;
+    std::vector<char*> batchBuffers;
+    ArenaPool arenaPool;
+    std::vector<udp::endpoint> batchEndpoints;
+    std::vector<std::size_t> batchBytes;
+
+#if defined(__linux__)
+    // recvmmsg headers, preallocated with the batch slots
+    std::vector<mmsghdr> batchHeaders;
+    std::vector<iovec> batchIovecs;
+#endif
+
+    // session lookups of this shard, ProcessUdpDatagram runs inside its read section
+    SessionDirectory::SReader directoryReader;
+
+    // endpoint routed datagrams counted for uid sampling
+    std::uint32_t uidVerifyCounter = 0;
+
+    // datagrams from endpoints without a session, limited per source endpoint before parsing
+    // bounded : idle senders are evicted when the map is full, new senders past the limit share unroutedOverflowBucket
+    struct SUnroutedSender
+    {
+        std::unique_ptr<TokenBucket> bucket;
+        std::chrono::steady_clock::time_point lastSeen;
+    };
+
+    std::unordered_map<udp::endpoint, SUnroutedSender, SEndpointHash> unroutedSenders;
+    std::chrono::steady_clock::time_point lastUnroutedSweep;
+    TokenBucket unroutedOverflowBucket;
+
+    // dropped datagram log throttle
+    std::chrono::steady_clock::time_point lastDropLog;
+    std::size_t unloggedDropCount = 0;
+
+    // send queue : sessions push without a lock, the shard strand is the only consumer
+    MpscRing<SUdpSendData> sendRing;
+    std::atomic<bool> isSending = false;
+
+    // batched send slots (frames are referenced, never copied)
+    std::vector<SUdpSendData> sendBatch;
+
+#if defined(__linux__)
+    // sendmmsg headers, preallocated with the send slots (2 iovecs per datagram : prefix, payload)
+    std::vector<mmsghdr> sendHeaders;
+    std::vector<iovec> sendIovecs;
+
+    // gso : UDP_SEGMENT control message per header, first batch slot of each header
+    std::vector<char> sendControls;
+    std::vector<std::size_t> sendHeaderFirstSlots;
+#endif
+};
+
 class Server final : public Base<Server>
 {
 public:
@@ -36,37 +124,82 @@ public:
 
 private:
     using UdpSocket = udp::socket;
+    using UdpShardPtr = std::shared_ptr<SUdpShard>;
 
 	std::shared_ptr<ContextManager> _normalCtxManager;
 	std::shared_ptr<ContextManager> _rpcCtxManager;
 	tcp::acceptor& _acceptor;
 
 	asio::io_context::strand _normalPrivateStrand;
-	asio::io_context::strand _rpcPrivateStrand;
 
-    std::shared_ptr<UdpSocket> _udpSocket;
+    // udp sockets sharing _allocatedUdpPort (SO_REUSEPORT, one per rpc io thread)
+    const bool _useReusePortSharding = true;
+    std::vector<UdpShardPtr> _udpShards;
     std::uint16_t _allocatedUdpPort;
 
-    std::mutex _sendDataQueueMutex;
-    bool _isSending;
-    std::queue<std::shared_ptr<std::pair<udp::endpoint, std::string>>> _sendDataQueue;
-
 	std::shared_ptr<GroupManager> _groupManager;
 	std::atomic<bool> _isRunning;
     std::atomic<std::size_t> _udpReceiveCount;
 
-    std::unordered_map<uuid, std::shared_ptr<Session>> _sessions;
-    std::mutex _sessionsMutex;
+    // lookups from the udp shards are lock free, only add/remove synchronize
+    SessionDirectory _sessions;
 
     const std::size_t _maxPacketSize = 65535;
 
+
+    // batched udp receive (drain up to _udpBatchSize datagrams per wakeup)
+    const bool _useBatchedUdpReceive = true;
+    const std::size_t _udpBatchSize = 32;
+
+    // linux udp gso (one message carries a run of equal sized datagrams to one endpoint)
+    // opt-in, turned off automatically when the kernel or the device rejects it
+    const bool _useUdpGso = false;
+    const std::size_t _udpGsoMaxSegments = 64;
+    const std::size_t _udpGsoMaxBytes = 65000;
+    std::atomic<bool> _isUdpGsoEnabled = false;
+
+    // per shard egress ring, a datagram is dropped (and counted) when its ring is full
+    const std::size_t _udpSendRingCapacity = 1 << 14;
+
+    // batched udp send (flush the drained send queue up to _udpSendBatchSize datagrams per syscall)
+    const bool _useBatchedUdpSend = true;
+    const std::size_t _udpSendBatchSize = 64;
+
+    // inbound packets of one wakeup are parsed into one pooled arena, reused when the last packet is released
+    // the arenas stay referenced until the group tick consumed their packets, a few ticks of wakeups per shard
+    const std::size_t _arenaBytesPerDatagram = 256;
+    const std::size_t _arenaPoolSizePerShard = 256;
+
+    // endpoint fast path (endpoint learned from a verified uid datagram routes the next ones before parsing)
+    // an endpoint claimed by two sessions is never indexed, its datagrams keep resolving by uid
+    const bool _dropUnknownUdpEndpoint = false; // true : drop legacy datagrams from unknown endpoints without parsing (token clients only, nothing is learned)
+    const std::uint32_t _uidVerifySampleRate = 64; // every Nth endpoint routed datagram has its uid checked
+
+    // udp ingress token buckets (0 rate : unlimited), excess datagrams are dropped before parsing
+    const double _udpIngressRatePerSession = 120.0; // datagrams/sec, ~4 per tick
+    const double _udpIngressBurstPerSession = 60.0;
+    const double _udpUnroutedRatePerEndpoint = 120.0; // legacy uid addressed clients, NAT rebound ports, handshaking clients
+    const double _udpUnroutedBurstPerEndpoint = 60.0;
+    const std::size_t _udpUnroutedEndpointLimit = 4096; // tracked senders per shard
+    const std::chrono::seconds _udpUnroutedIdleTimeout = std::chrono::seconds(5);
+    const double _udpUnroutedOverflowRatePerShard = 2000.0; // senders over the endpoint limit
+    const double _udpUnroutedOverflowBurstPerShard = 500.0;
+    const std::chrono::seconds _udpDropLogInterval = std::chrono::seconds(1); // per shard
+
 	void AcceptClientAsync();
 	void InitSessionNetwork(const std::shared_ptr<Session>& newSession);
 
 	// Udp Socket Functions
-    void AsyncReceiveUdpData();
-    void EnqueueSendData(std::shared_ptr<std::pair<udp::endpoint, std::string>> sendData);
-    void AsyncSendUdpData();
+    std::shared_ptr<UdpSocket> OpenUdpSocket(std::uint16_t port, bool reusePort);
+    void AsyncReceiveUdpData(UdpShardPtr shard);
+    void AsyncReceiveUdpBatch(UdpShardPtr shard);
+    std::size_t ReceiveUdpBatch(SUdpShard& shard);
+    void DropUdpDatagram(SUdpShard& shard, const udp::endpoint& senderEndPoint, std::string_view reason, TokenBucket::Clock::time_point now);
+    bool TryConsumeUnroutedIngress(SUdpShard& shard, const udp::endpoint& senderEndPoint, TokenBucket::Clock::time_point now);
+    void ProcessUdpDatagram(SUdpShard& shard, const std::shared_ptr<google::protobuf::Arena>& arena, const char* data, std::size_t bytesRead, const udp::endpoint& senderEndPoint);
+    void EnqueueSendData(SUdpSendData sendData);
+    void AsyncSendUdpData(UdpShardPtr shard);
+    void SendUdpBatch(SUdpShard& shard, std::queue<SUdpSendData>& sendQueue);
 
     void AddSession(std::shared_ptr<Session> newSession);
     void RemoveSession(uuid sessionId);
@@ -8,13 +8,17 @@
 Session::Session(const std::shared_ptr<ContextManager>& contextManager, const std::shared_ptr<ContextManager>& rpcContextManager)
     : _normalCtxManager(contextManager), _rpcCtxManager(rpcContextManager),
     _tcpSocketPtr(std::make_shared<TcpSocket>(_normalCtxManager->GetContext())),
+    _tcpReceiveBuffer(TCP_RECEIVE_BUFFER_SIZE),
     _lastRtt(0),
     _normalPrivateStrand(_normalCtxManager->GetContext()),
     _rpcPrivateStrand(_rpcCtxManager->GetContext())
 {
     _isTcpSending = false;
-    _isSerializingUdp = false;
-    _userState = {};
+    _isFlushingUdp = false;
+    _udpPacingTimer = std::make_shared<asio::steady_timer>(_rpcCtxManager->GetContext());
+    _handshakeTimer = std::make_shared<asio::steady_timer>(_normalCtxManager->GetContext());
+    _tcpWriteSignal = std::make_shared<asio::steady_timer>(_normalCtxManager->GetContext());
+    _tcpWriteSignal->expires_at(asio::steady_timer::time_point::max());
 }
 
 void Session::Start()
@@ -34,9 +38,7 @@ void Session::Start()
             self->SendGameStatePacket(onComplete);
     });
 
-    // Async Functions Start
-    TcpAsyncReadSize();
-
+    // tcp reader is already running since the handshake
     _pingTimer->Start();
     _sendStateTimer->Start();
     _isConnected = true;
@@ -51,8 +53,20 @@ void Session::Stop(bool forceStop)
 
     _tcpSocketPtr->close();
 
-    _pingTimer->Stop(true);
-    _sendStateTimer->Stop(true);
+    // timers exist only once the session joined a group
+    if (_pingTimer) _pingTimer->Stop(true);
+    if (_sendStateTimer) _sendStateTimer->Stop(true);
+
+    // timers are armed on their strands, cancel them there
+    auto pacingTimer = _udpPacingTimer;
+    asio::post(_rpcPrivateStrand, [pacingTimer]() { pacingTimer->cancel(); });
+    auto handshakeTimer = _handshakeTimer;
+    asio::post(_normalPrivateStrand, [handshakeTimer]() { handshakeTimer->cancel(); });
+
+    // wake the parked writer so it can leave its loop
+    _isTcpWriterStopped = true;
+    auto writeSignal = _tcpWriteSignal;
+    asio::post(_normalPrivateStrand, [writeSignal]() { writeSignal->cancel(); });
 
     if (forceStop)
         return;
@@ -61,201 +75,261 @@ void Session::Stop(bool forceStop)
     if(_onStopCallbackByServer) _onStopCallbackByServer(shared_from_this());
 }
 
-// wrapping ExchangeUdpPort, Using Blocking Pool
-void Session::AsyncExchangeUdpPortWork(std::uint16_t udpPort, std::function<void(bool success)> onComplete)
+void Session::AsyncHandshake(std::uint16_t udpPort, HandshakeHandler onComplete)
 {
-    auto self(shared_from_this());
+    _onHandshakeComplete = std::move(onComplete);
+    asio::co_spawn(_normalPrivateStrand, RunSession(shared_from_this(), udpPort), asio::detached);
+}
 
-    asio::post(_normalCtxManager->GetBlockingPool(), [self, onComplete, udpPort]()
-    {
-        bool success = self->ExchangeUdpPort(udpPort);
-        asio::post(self->_normalPrivateStrand, [self, success, onComplete]() { onComplete(success); });
-    });
+SessionAwaitable<void> Session::RunSession(std::shared_ptr<Session> self, std::uint16_t udpPort)
+{
+    error_code ec;
+    const auto remoteEndpoint = _tcpSocketPtr->remote_endpoint(ec);
+    _connectedIp = ec ? "unknown" : remoteEndpoint.address().to_string();
+
+    // writer lives until Stop
+    asio::co_spawn(_normalPrivateStrand, TcpWriteLoop(self), asio::detached);
+
+    const bool isHandshaked = co_await RunHandshake(udpPort);
+    if (!FinishHandshake(isHandshaked))
+        co_return; // server stops the session and releases the token
+
+    co_await TcpReadLoop();
 }
 
-bool Session::ExchangeUdpPort(std::uint16_t udpPort)
+SessionAwaitable<bool> Session::RunHandshake(std::uint16_t udpPort)
 {
-    const std::string connectedIp = _tcpSocketPtr->remote_endpoint().address().to_string();
     auto netUdpPort = htons(udpPort); // Server Main Udp Socket Port
+
+    // [udpPort(2)] only, old clients reject any other size
     std::string sendUdpByte(reinterpret_cast<char*>(&netUdpPort), sizeof(netUdpPort));
 
-    spdlog::info("port {} try exchange", ntohs(netUdpPort));
+    spdlog::info("port {} try exchange", udpPort);
+    SendHandshakePrompt(UDP_PORT, std::move(sendUdpByte));
 
-    RpcPacket packet;
-    packet.set_method(UDP_PORT);
-    packet.set_data(sendUdpByte);
+    RpcPacket reply;
+    if (!co_await ReadHandshakeReply(UDP_PORT, reply) || !ApplyUdpPortReply(reply))
+        co_return false;
 
-    std::string udpPortPacket;
-    if (!packet.SerializeToString(&udpPortPacket))
-    {
-        spdlog::error("failed to serialize UDP port packet {}", connectedIp);
-        return false;
-    }
+    // the client offered capabilities : token and accepted capabilities go to it alone
+    if (_isCapabilityOffered)
+        SendUdpPortAccept();
 
-    const auto sendDataSize = static_cast<uint32_t>(udpPortPacket.size());
-    auto sendNetSize = htonl(sendDataSize);
+    // pipelined hello : user info and group info came in the same packet
+    if (HasCapability(NetworkProtocol::CAPABILITY_PIPELINED_HANDSHAKE))
+        co_return ApplyHelloReply(reply);
 
-    std::vector<char> receiveBuffer;
-    uint32_t receiveNetSize = 0;
+    SendHandshakePrompt(USER_INFO, {});
+    if (!co_await ReadHandshakeReply(USER_INFO, reply) || !ApplyUserInfoReply(reply))
+        co_return false;
 
-    // 예외 처리를 위한 system::error_code -> std::error_code
-    error_code ec;
-    asio::write(*_tcpSocketPtr, asio::buffer(&sendNetSize, sizeof(sendNetSize)), ec); // send size
-    if (!ec) asio::write(*_tcpSocketPtr, asio::buffer(udpPortPacket), ec); // send data
-    if (!ec) asio::read(*_tcpSocketPtr, asio::buffer(&receiveNetSize, sizeof(uint32_t)), ec); // receive size
+    SendHandshakePrompt(GROUP_INFO, {});
+    if (!co_await ReadHandshakeReply(GROUP_INFO, reply) || !ApplyGroupInfoReply(reply))
+        co_return false;
 
-    // recive size calculate
-    const auto receiveDataSize = ntohl(receiveNetSize);
-    if (!ec && receiveDataSize > 0)
-    {
-        receiveBuffer.resize(receiveDataSize);
-        if (!ec) asio::read(*_tcpSocketPtr, asio::buffer(receiveBuffer), ec); // receive data
-    }
+    co_return true;
+}
+
+void Session::SendUdpPortAccept()
+{
+    const auto netUdpToken = htonl(_udpToken);
+    const auto netCapabilities = htonl(_clientCapabilities);
+
+    // [token(4)][capabilities(4)]
+    std::string acceptData(reinterpret_cast<const char*>(&netUdpToken), sizeof(netUdpToken));
+    acceptData.append(reinterpret_cast<const char*>(&netCapabilities), sizeof(netCapabilities));
+
+    SendHandshakePrompt(UDP_PORT, std::move(acceptData));
+}
+
+void Session::SendHandshakePrompt(RpcMethod method, std::string data)
+{
+    RpcPacket packet;
+    packet.set_method(method);
+    packet.set_data(std::move(data));
+
+    EnqueueTcpSendData(std::make_shared<std::string>(packet.SerializeAsString()));
+}
 
-    // 어느 지점에서든 error_code가 있을 때 -> 비정상 작동 종료
-    if (ec || receiveDataSize == 0)
+SessionAwaitable<bool> Session::ReadHandshakeReply(RpcMethod method, RpcPacket& reply)
+{
+    // deadline of this step, expiry cancels the pending read so a slow or silent client never holds the session
+    auto self(shared_from_this());
+    _handshakeTimer->expires_after(_handshakeStepTimeout);
+    _handshakeTimer->async_wait(asio::bind_executor(_normalPrivateStrand, [self, method](const std::error_code& ec)
     {
-        spdlog::error("{} : network error occured ({})", connectedIp, ec.message());
-        return false;
-    }
+        // a completion queued before the timer was re-armed sees the later expiry
+        if (ec || self->_handshakeTimer->expiry() > asio::steady_timer::clock_type::now())
+            return;
+
+        spdlog::error("{} : handshake timed out ({})", self->_connectedIp, Util::MethodToString(method));
+        error_code cancelEc;
+        self->_tcpSocketPtr->cancel(cancelEc);
+    }));
 
-    // parse receive data
-    RpcPacket receiveUdpPortPacket;
-    if (!receiveUdpPortPacket.ParseFromArray(receiveBuffer.data(), static_cast<int>(receiveDataSize)))
+    std::string_view body;
+    auto result = TakeTcpFrame(body);
+    while (result == TcpFrameResult::Partial)
     {
-        spdlog::error("{} : failed to parse UDP port packet", connectedIp);
-        return false;
+        if (const auto ec = co_await TcpReadSome())
+        {
+            spdlog::error("{} : network error occured ({}) in handshake", _connectedIp, ec.message());
+            co_return false;
+        }
+
+        result = TakeTcpFrame(body);
     }
 
-    if (receiveUdpPortPacket.method() != UDP_PORT)
+    _handshakeTimer->cancel();
+    if (result == TcpFrameResult::Broken)
+        co_return false;
+
+    if (!reply.ParseFromArray(body.data(), static_cast<int>(body.size())))
     {
-        // Invalid Method 확인
-        const auto* descriptor = RpcMethod_descriptor();
-        const auto& methodName = descriptor->FindValueByNumber(receiveUdpPortPacket.method())->name();
-        spdlog::error("{} : invalid method ({})", connectedIp, methodName);
-        return false;
+        spdlog::error("{} : parsing error occured in handshake ({})", _connectedIp, Util::MethodToString(method));
+        co_return false;
     }
 
-    // network to host
-    std::uint16_t netClientPort;
-    std::memcpy(&netClientPort, receiveUdpPortPacket.data().data(), sizeof(netClientPort));
-    auto clientPort = ntohs(netClientPort);
-
-    // Set the UDP endpoint
-    _udpSendEp = udp::endpoint(_tcpSocketPtr->remote_endpoint().address(), clientPort);
-    spdlog::info("client port get {}", clientPort);
-    return true;
+    co_return true;
 }
 
-bool Session::ReceiveUserInfo()
+bool Session::FinishHandshake(bool success)
 {
-    const std::string connectedIp = _tcpSocketPtr->remote_endpoint().address().to_string();
-
-    RpcPacket packet;
-    packet.set_method(USER_INFO);
+    _handshakeTimer->cancel();
 
-    auto serializedData = packet.SerializeAsString();
-    const uint32_t sendDataSize = static_cast<uint32_t>(serializedData.size());
-    const uint32_t sendNetSize = htonl(sendDataSize);
+    auto onComplete = std::move(_onHandshakeComplete);
+    _onHandshakeComplete = nullptr;
+    if (onComplete && !onComplete(success, success ? std::make_shared<GroupDto>(_groupDto) : nullptr))
+        success = false;
 
-    uint32_t receiveNetSize = 0;
-    std::vector<char> receiveBuffer;
+    if (!success || !HasCapability(NetworkProtocol::CAPABILITY_PIPELINED_HANDSHAKE))
+        return success;
 
-    // 순차적으로 error_code가 없는 경우 다음 스텝을 진행
-    error_code ec;
-    asio::write(*_tcpSocketPtr, asio::buffer(&sendNetSize, sizeof(sendNetSize)), ec);
-    if (!ec) asio::write(*_tcpSocketPtr, asio::buffer(serializedData), ec);
-    if (!ec) asio::read(*_tcpSocketPtr, asio::buffer(&receiveNetSize, sizeof(uint32_t)), ec);
+    // combined reply of the pipelined hello, session is already in its group
+    RpcPacket readyPacket;
+    readyPacket.set_method(GROUP_INFO);
+    readyPacket.set_data(_groupDto.SerializeAsString());
+    EnqueueTcpSendData(std::make_shared<std::string>(readyPacket.SerializeAsString()));
+    return true;
+}
 
-    const auto receiveDataSize = ntohl(receiveNetSize);
-    if (!ec && receiveNetSize > 0)
+bool Session::ApplyUdpPortReply(const RpcPacket& packet)
+{
+    if (packet.method() != UDP_PORT)
     {
-        receiveBuffer.resize(receiveDataSize);
-        asio::read(*_tcpSocketPtr, asio::buffer(receiveBuffer), ec);
+        spdlog::error("{} : invalid method ({})", _connectedIp, Util::MethodToString(packet.method()));
+        return false;
     }
 
-    // 어느 시점이든 오류가 나면 처리
-    if (ec || receiveNetSize == 0)
+    const auto& udpPortData = packet.data();
+    if (udpPortData.size() < sizeof(std::uint16_t))
     {
-        spdlog::error("{} : network error occured ({}) in receive user info", connectedIp, ec.message());
+        spdlog::error("{} : invalid UDP port data size ({})", _connectedIp, udpPortData.size());
         return false;
     }
 
-    RpcPacket receivePacket;
-    if (!receivePacket.ParseFromArray(receiveBuffer.data(), static_cast<int>(receiveDataSize)))
+    // network to host
+    std::uint16_t netClientPort;
+    std::memcpy(&netClientPort, udpPortData.data(), sizeof(netClientPort));
+    auto clientPort = ntohs(netClientPort);
+
+    // capabilities offered by the client, only the ones the server supports are accepted
+    if (udpPortData.size() >= sizeof(std::uint16_t) + sizeof(std::uint32_t))
     {
-        spdlog::error("{} : parsing error occured in receive user info", connectedIp);
-        return false;
+        std::uint32_t netClientCapabilities;
+        std::memcpy(&netClientCapabilities, udpPortData.data() + sizeof(std::uint16_t), sizeof(netClientCapabilities));
+        _clientCapabilities = ntohl(netClientCapabilities) & NetworkProtocol::SERVER_CAPABILITIES;
+        _isCapabilityOffered = true;
     }
 
-    if (receivePacket.method() != USER_INFO)
+    // Set the UDP endpoint
+    error_code ec;
+    const auto remoteEndpoint = _tcpSocketPtr->remote_endpoint(ec);
+    if (ec)
     {
-        // Invalid Method Check
-        const auto* descriptor = RpcMethod_descriptor();
-        const auto& methodName = descriptor->FindValueByNumber(receivePacket.method())->name();
-        spdlog::error("{} : invalid method ({})", connectedIp, methodName);
+        spdlog::error("{} : network error occured ({})", _connectedIp, ec.message());
         return false;
     }
 
-    _sessionInfo.set_uid(receivePacket.uid());
-    _sessionInfo.set_username(receivePacket.data().data());
-
-    spdlog::info("{} : session user info exchanged complete", _sessionInfo.uid());
+    _udpSendEp = udp::endpoint(remoteEndpoint.address(), clientPort);
+    spdlog::info("client port get {} (capabilities: {})", clientPort, _clientCapabilities);
     return true;
 }
 
-// warpping ReceiveUserInfo, Using BlockingPool
-void Session::AsyncReceiveUserInfo(std::function<void(bool success)> onComplete)
+bool Session::ApplyUserInfoReply(const RpcPacket& packet)
 {
-    auto self(shared_from_this());
-    asio::post(_normalCtxManager->GetBlockingPool(), [self, onComplete]()
+    if (packet.method() != USER_INFO)
     {
-        bool success = self->ReceiveUserInfo();
+        // Invalid Method Check
+        spdlog::error("{} : invalid method ({})", _connectedIp, Util::MethodToString(packet.method()));
+        return false;
+    }
 
-        asio::post(self->_normalPrivateStrand, [self, success, onComplete]() { onComplete(success); });
-    });
+    return ApplyUserInfo(packet.uid(), packet.data().c_str());
 }
 
-bool Session::ReceiveGroupInfo(std::shared_ptr<GroupDto>& groupInfo)
+bool Session::ApplyGroupInfoReply(const RpcPacket& packet)
 {
-    RpcPacket packet;
-    packet.set_method(GROUP_INFO);
-
-    const auto serializedData = packet.SerializeAsString();
-    const auto sendDataSize = static_cast<std::uint32_t>(serializedData.size());
-    const auto sendNetSize = htonl(sendDataSize);
+    if (packet.method() != GROUP_INFO)
+    {
+        spdlog::error("{} : invalid method ({})", _sessionInfo.uid(), Util::MethodToString(packet.method()));
+        return false;
+    }
 
-    std::uint32_t receiveNetSize = 0;
-    std::vector<char> receiveBuffer;
+    return ApplyGroupInfo(packet.data());
+}
 
-    error_code ec;
-    asio::write(*_tcpSocketPtr, asio::buffer(&sendNetSize, sizeof(sendNetSize)), ec);
-    if (!ec) asio::write(*_tcpSocketPtr, asio::buffer(serializedData), ec);
-    if (!ec) asio::read(*_tcpSocketPtr, asio::buffer(&receiveNetSize, sizeof(std::uint32_t)), ec);
+bool Session::ApplyHelloReply(const RpcPacket& packet)
+{
+    // [udpPort(2)][capabilities(4)] already applied by ApplyUdpPortReply
+    constexpr std::size_t helloHeaderSize = sizeof(std::uint16_t) + sizeof(std::uint32_t);
 
-    const auto receiveDataSize = ntohl(receiveNetSize);
-    if (!ec && receiveDataSize > 0)
+    std::string_view helloData(packet.data());
+    if (helloData.size() < helloHeaderSize + sizeof(std::uint16_t))
     {
-        receiveBuffer.resize(receiveDataSize);
-        asio::read(*_tcpSocketPtr, asio::buffer(receiveBuffer), ec);
+        spdlog::error("{} : invalid hello data size ({})", _connectedIp, helloData.size());
+        return false;
     }
+    helloData.remove_prefix(helloHeaderSize);
+
+    std::uint16_t netUsernameSize;
+    std::memcpy(&netUsernameSize, helloData.data(), sizeof(netUsernameSize));
+    const auto usernameSize = ntohs(netUsernameSize);
+    helloData.remove_prefix(sizeof(netUsernameSize));
 
-    if (ec || receiveDataSize == 0)
+    if (helloData.size() < usernameSize)
     {
-        spdlog::error("{} : network error occured ({}) in receive group info", _sessionInfo.uid(), ec.message());
+        spdlog::error("{} : invalid hello username size ({})", _connectedIp, usernameSize);
         return false;
     }
 
-    // parsing packet to RpcPacket
-    RpcPacket receiveGroupInfo;
-    if (!receiveGroupInfo.ParseFromArray(receiveBuffer.data(), static_cast<int>(receiveDataSize)))
+    if (!ApplyUserInfo(packet.uid(), helloData.substr(0, usernameSize)))
+        return false;
+
+    return ApplyGroupInfo(helloData.substr(usernameSize));
+}
+
+bool Session::ApplyUserInfo(const std::string& uid, std::string_view username)
+{
+    const auto sessionUuid = uuid::from_string(uid);
+    if (!sessionUuid)
     {
-        spdlog::error("{} : parsing error occured in receive group info", _sessionInfo.uid());
+        spdlog::error("{} : invalid user id ({})", _connectedIp, uid);
         return false;
     }
 
+    _sessionUuid = *sessionUuid;
+    _sessionInfo.set_uid(uid);
+    _sessionInfo.set_username(std::string(username));
+
+    spdlog::info("{} : session user info exchanged complete", _sessionInfo.uid());
+    return true;
+}
+
+bool Session::ApplyGroupInfo(std::string_view groupData)
+{
     // parsing data to group dto
-    if (!_groupDto.ParseFromString(receiveGroupInfo.data()))
+    if (!_groupDto.ParseFromArray(groupData.data(), static_cast<int>(groupData.size())))
     {
         spdlog::error("{} : parsing error occured in receive group info", _sessionInfo.uid());
         return false;
@@ -263,22 +337,9 @@ bool Session::ReceiveGroupInfo(std::shared_ptr<GroupDto>& groupInfo)
 
     // parsing complete
     spdlog::info("{} : session exchange group info complete", _sessionInfo.uid());
-    groupInfo = std::make_shared<GroupDto>(_groupDto);
     return true;
 }
 
-void Session::AsyncReceiveGroupInfo(std::function<void(bool success, std::shared_ptr<GroupDto> groupInfo)> onComplete)
-{
-    auto self(shared_from_this());
-    asio::post(_normalCtxManager->GetBlockingPool(), [self, onComplete]()
-    {
-        std::shared_ptr<GroupDto> group = nullptr;
-        bool success = self->ReceiveGroupInfo(group); // exchange and set group reference
-
-        asio::post(self->_normalPrivateStrand, [self, success, group, onComplete]() { onComplete(success, group); });
-    });
-}
-
 // set by LockstepGroup.cpp
 void Session::SetStopCallbackByGroup(StopCallback stopCallback)
 {
@@ -298,44 +359,89 @@ void Session::SetCollectInputAction(SessionInput inputAction)
 }
 
 // called per frame
-void Session::SerializeRpcPacketAndEnqueueData()
+void Session::FlushSendUdpFrames()
 {
     if (_sendDataByUdp == nullptr)
     {
         spdlog::error("send callback is not set");
-        _isSerializingUdp = false; // Stop the loop if callback is not set
+        _isFlushingUdp = false; // Stop the loop if callback is not set
         return;
     }
 
-	auto self(shared_from_this());
-
-    std::string serializedData;
-    // Dequeue and serialize within the lock to ensure consistency
+    std::queue<std::shared_ptr<const UdpFrameList>> localQueue;
     {
+        std::lock_guard<std::mutex> lock(_sendUdpQueueMutex);
+        if (_sendUdpFrameQueue.empty())
         {
-            std::lock_guard<std::mutex> lock(_sendUdpQueueMutex);
-            if (_sendUdpPacketQueue.empty())
-            {
-                _isSerializingUdp = false; // Stop the loop
-                return;
-            }
+            _isFlushingUdp = false; // Stop the loop
+            return;
         }
 
-        auto nextPacket = DequeueSendUdpPackets(); // This is called within the lock
-        if (!nextPacket.SerializeToString(&serializedData))
+        _sendUdpFrameQueue.swap(localQueue);
+    }
+
+    // frames are already serialized by the group, only the references are handed to the server
+    while (!localQueue.empty())
+    {
+        for (const auto& frame : *localQueue.front())
         {
-            spdlog::error("{} : rpc packet serialize failed", _sessionInfo.uid());
-            // Post again to continue the loop for other packets.
-            asio::post(_rpcPrivateStrand, [self]() { self->SerializeRpcPacketAndEnqueueData(); });
-            return;
+            if (_useUdpPacing)
+                PaceUdpFrame(frame);
+            else
+                _sendDataByUdp({ _udpSendEp, frame });
         }
+
+        localQueue.pop();
     }
 
-    auto sendDataPair = std::make_shared<std::pair<udp::endpoint, std::string>>(_udpSendEp, serializedData);
-    _sendDataByUdp(std::move(sendDataPair));
+    // Post again to process frames queued meanwhile.
+    auto self(shared_from_this());
+    asio::post(_rpcPrivateStrand, [self]() { self->FlushSendUdpFrames(); });
+}
+
+void Session::PaceUdpFrame(std::shared_ptr<const UdpFrame> frame)
+{
+    if (frame->GetPriority() == UdpFrame::Priority::High)
+        _pacedHighFrames.push_back(std::move(frame));
+    else
+        _pacedFrames.push_back(std::move(frame));
+
+    if (_isPacingArmed)
+        return;
 
-    // Post again to process the next item in the queue.
-    asio::post(_rpcPrivateStrand, [self]() { self->SerializeRpcPacketAndEnqueueData(); });
+    // spread the sessions of a group over the tick window by their token slot
+    const auto windowUs = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::milliseconds(TICK_TIME)).count());
+    const std::uint64_t slot = _udpToken & 0xFFFF;
+    ArmUdpPacing(std::chrono::microseconds((slot * 2654435761u) % windowUs));
+}
+
+void Session::ArmUdpPacing(std::chrono::microseconds delay)
+{
+    _isPacingArmed = true;
+
+    auto self(shared_from_this());
+    _udpPacingTimer->expires_after(delay);
+    _udpPacingTimer->async_wait(asio::bind_executor(_rpcPrivateStrand, [self](const std::error_code& ec)
+    {
+        self->_isPacingArmed = false;
+        if (ec)
+            return;
+
+        self->ReleasePacedUdpFrames();
+    }));
+}
+
+void Session::ReleasePacedUdpFrames()
+{
+    for (auto* frames : { &_pacedHighFrames, &_pacedFrames })
+    {
+        for (auto& frame : *frames)
+        {
+            _sendDataByUdp({ _udpSendEp, std::move(frame) });
+        }
+
+        frames->clear();
+    }
 }
 
 // set by server.cpp
@@ -345,10 +451,10 @@ void Session::SetSendDataByUdpAction(SendDataByUdp sendDataFunction)
 }
 
 // called by server.cpp
-void Session::CollectInput(std::shared_ptr<RpcPacket> receivePacket)
+void Session::CollectInput(std::shared_ptr<SSendPacket> input)
 {
     auto self(shared_from_this());
-    asio::post(_rpcPrivateStrand, [self, receivePacket]()
+    asio::post(_rpcPrivateStrand, [self, input = std::move(input)]()
     {
         if (self->_inputAction == nullptr)
         {
@@ -356,60 +462,31 @@ void Session::CollectInput(std::shared_ptr<RpcPacket> receivePacket)
             return;
         }
 
-        auto rpcRequest =
-            std::make_shared<std::pair<uuid, std::shared_ptr<RpcPacket>>>(self->GetSessionUuid(), receivePacket);
-
-        self->_inputAction(rpcRequest); // Collect input to group
-
-        // process server validation
-        if (rpcRequest->second->method() == RpcMethod::Atk)
-            return;
-
-        {
-            std::lock_guard<std::mutex> updateQueueLock(self->_statesQueueMutex);
-            self->_statesQueue.push(*rpcRequest->second);
-
-            // wake-up update own state function
-            if (!self->_isOwnStateUpdating)
-            {
-                self->_isOwnStateUpdating = true;
-                asio::post(self->_normalPrivateStrand, [self]() { self->AsyncUpdateOwnState(); });
-            }
-        }
+        // state is applied by the group at tick
+        self->_inputAction(input); // Collect input to group
     });
 }
 
-void Session::EnqueueSendUdpPackets(const std::list<std::shared_ptr<SSendPacket>> sendPackets)
+void Session::EnqueueSendUdpFrames(std::shared_ptr<const UdpFrameList> frames)
 {
     std::lock_guard<std::mutex> lock(_sendUdpQueueMutex);
-	for (const auto& packet : sendPackets)
-	{
-        // rpc packet deep copy
-        RpcPacket listupPacket;
-        listupPacket.CopyFrom(*packet->packet);
-
-        // copied RpcPacket push
-		_sendUdpPacketQueue.push(listupPacket);
-	}
+    _sendUdpFrameQueue.push(std::move(frames));
 
-    if (!_isSerializingUdp)
+    if (!_isFlushingUdp)
     {
-        _isSerializingUdp = true;
+        _isFlushingUdp = true;
         auto self(shared_from_this());
-        asio::post(_rpcPrivateStrand, [self]() { self->SerializeRpcPacketAndEnqueueData(); });
+        asio::post(_rpcPrivateStrand, [self]() { self->FlushSendUdpFrames(); });
     }
 }
 
-RpcPacket Session::DequeueSendUdpPackets()
-{
-	std::lock_guard<std::mutex> lock(_sendUdpQueueMutex);
-	auto nextPacket = _sendUdpPacketQueue.front();
-	_sendUdpPacketQueue.pop();
-	return nextPacket;
-}
-
 void Session::SendPingPacket(CompletionHandler onComplete)
 {
+    // slow consumer report, once per ping while the client lags behind its tcp stream
+    const auto tcpSendQueueDepth = GetTcpSendQueueDepth();
+    if (tcpSendQueueDepth >= _tcpSendQueueWarnDepth)
+        spdlog::warn("{} : tcp send queue depth {} / {}", _sessionInfo.uid(), tcpSendQueueDepth, _tcpSendQueueHardCap);
+
     RpcPacket packet;
     packet.set_method(PING);
     const auto serializePingPacket = std::make_shared<std::string>(packet.SerializeAsString());
@@ -419,9 +496,9 @@ void Session::SendPingPacket(CompletionHandler onComplete)
     onComplete();
 }
 
-void Session::ProcessTcpRequest(const std::shared_ptr<RpcPacket> packet)
+void Session::ProcessTcpRequest(const RpcPacket& packet)
 {
-    switch (packet->method())
+    switch (packet.method())
     {
     case PONG:
     {
@@ -446,7 +523,7 @@ void Session::ProcessTcpRequest(const std::shared_ptr<RpcPacket> packet)
         break;
 
     default:
-        spdlog::error("{} : invalid packet method ({})", _sessionInfo.uid(), Util::MethodToString(packet->method()));
+        spdlog::error("{} : invalid packet method ({})", _sessionInfo.uid(), Util::MethodToString(packet.method()));
         break;
     }
 }
@@ -454,213 +531,239 @@ void Session::ProcessTcpRequest(const std::shared_ptr<RpcPacket> packet)
 void Session::EnqueueTcpSendData(std::shared_ptr<std::string> data)
 {
     std::lock_guard<std::mutex> lock(_sendTcpQueueMutex);
-    _sendTcpQueue.push(std::move(data));
+    if (_isTcpSendOverflowed)
+        return;
 
-    if (!_isTcpSending)
+    if (_sendTcpQueue.size() >= _tcpSendQueueHardCap)
     {
-        _isTcpSending = true;
+        // client is not reading, drop it instead of buffering forever
+        _isTcpSendOverflowed = true;
+        spdlog::warn("{} : tcp send queue over {}, disconnecting", _sessionInfo.uid(), _tcpSendQueueHardCap);
+        ConsoleMonitor::Get().IncrementTcpSendOverflow();
 
         auto self(shared_from_this());
-        asio::post(_normalPrivateStrand, [self]() { self->TcpAsyncWrite(); });
+        asio::post(_normalPrivateStrand, [self]() { self->Stop(false); });
+        return;
     }
+
+    _sendTcpQueue.push(std::move(data));
+    SignalTcpWriter();
 }
 
-void Session::TcpAsyncWrite()
+void Session::EnqueueTcpStateData(std::shared_ptr<std::string> data)
 {
-    auto self(shared_from_this());
-    std::shared_ptr<std::string> nextData;
+    std::lock_guard<std::mutex> lock(_sendTcpQueueMutex);
+    if (_isTcpSendOverflowed)
+        return;
+
+    // an unsent snapshot is stale once a newer one exists
+    if (_pendingTcpState)
+        ConsoleMonitor::Get().IncrementTcpSendCoalesced();
+
+    _pendingTcpState = std::move(data);
+    SignalTcpWriter();
+}
+
+void Session::SignalTcpWriter()
+{
+    const auto depth = _sendTcpQueue.size() + (_pendingTcpState ? 1 : 0);
+    _tcpSendQueueDepth.store(depth, std::memory_order_relaxed);
+    ConsoleMonitor::Get().UpdateTcpSendQueueDepth(depth);
 
+    if (!_isTcpSending)
     {
-        std::lock_guard<std::mutex> lock(_sendTcpQueueMutex);
-        if (_sendTcpQueue.empty())
-        {
-            _isTcpSending = false;
-            return;
-        }
+        _isTcpSending = true;
 
-        nextData = std::move(_sendTcpQueue.front());
-        _sendTcpQueue.pop();
+        // writer is parked on the signal, cancel resumes it on the strand
+        auto writeSignal = _tcpWriteSignal;
+        asio::post(_normalPrivateStrand, [writeSignal]() { writeSignal->cancel(); });
     }
+}
 
-    const std::int32_t dataSize = static_cast<std::int32_t>(nextData->size()); // 4 byte
-    const std::int32_t netSize = htonl(dataSize); // 4 byte size Big-Endian
-
-    asio::async_write(*_tcpSocketPtr, asio::buffer(&netSize, sizeof(netSize)),
-        asio::bind_executor(_normalPrivateStrand, [self, nextData](const std::error_code& sizeEc, std::size_t)
+SessionAwaitable<void> Session::TcpWriteLoop(std::shared_ptr<Session> self)
+{
+    while (!_isTcpWriterStopped)
     {
-        if (sizeEc)
-        {
-            spdlog::error("{} : TCP error sending size ({})", self->_sessionInfo.uid(), sizeEc.message());
-            // If an error occurs, we should probably stop the send loop, but for now, we just log and continue the loop to try the next message.
-            asio::post(self->_normalPrivateStrand, [self]() { self->TcpAsyncWrite(); });
-            return;
-        }
+        _tcpWriteNetSizes.clear();
+        _tcpWriteBodies.clear();
+        _tcpWriteBuffers.clear();
 
-        asio::async_write(*self->_tcpSocketPtr, asio::buffer(*nextData),
-            asio::bind_executor(self->_normalPrivateStrand, [self, nextData](const std::error_code& dataEc, std::size_t)
         {
-            if (dataEc)
+            std::lock_guard<std::mutex> lock(_sendTcpQueueMutex);
+            if (_sendTcpQueue.empty() && !_pendingTcpState)
             {
-                spdlog::error("TCP error sending data to {} : {}", self->_sessionInfo.uid(), dataEc.message());
+                _isTcpSending = false;
             }
 
-            // Continue the loop for the next item.
-            asio::post(self->_normalPrivateStrand, [self]() { self->TcpAsyncWrite(); });
-        }));
-    }));
-}
-
-void Session::TcpAsyncReadSize()
-{
-    _tcpDataSize = 0;
-    _tcpNetSize = 0;
+            // newest game state first, then the queue up to the byte cap (at least one message)
+            std::size_t writeBytes = 0;
+            if (_pendingTcpState)
+            {
+                writeBytes += sizeof(std::uint32_t) + _pendingTcpState->size();
+                _tcpWriteBodies.push_back(std::move(_pendingTcpState));
+                _pendingTcpState = nullptr;
+            }
 
-    auto self(shared_from_this());
-    asio::async_read(*_tcpSocketPtr, asio::buffer(&_tcpNetSize, sizeof(_tcpNetSize)),
-        asio::bind_executor(_normalPrivateStrand, [self](const std::error_code& sizeEc, std::size_t)
-    {
-        if (sizeEc)
-        {
-            if (sizeEc == asio::error::eof
-                || sizeEc == asio::error::connection_reset
-                || sizeEc == asio::error::connection_aborted
-                || sizeEc == asio::error::operation_aborted)
+            while (!_sendTcpQueue.empty() && (_tcpWriteBodies.empty() || writeBytes + sizeof(std::uint32_t) + _sendTcpQueue.front()->size() <= _tcpWriteByteCap))
             {
-                spdlog::info("session {} : TcpaSyncRead aborted", self->_sessionInfo.uid());
-                self->Stop(false);
-                return;
+                writeBytes += sizeof(std::uint32_t) + _sendTcpQueue.front()->size();
+                _tcpWriteBodies.push_back(std::move(_sendTcpQueue.front()));
+                _sendTcpQueue.pop();
             }
 
-            spdlog::error("{} : TCP error receiving size ({})", self->_sessionInfo.uid(), sizeEc.message());
-            return;
+            _tcpSendQueueDepth.store(_sendTcpQueue.size(), std::memory_order_relaxed);
+        }
+
+        if (_tcpWriteBodies.empty())
+        {
+            // parked until EnqueueTcpSendData or Stop cancels the signal
+            error_code ec;
+            co_await _tcpWriteSignal->async_wait(asio::redirect_error(USE_SESSION_AWAITABLE, ec));
+            continue;
         }
 
-        // Convert network byte order to host byte order
-        self->_tcpDataSize = ntohl(self->_tcpNetSize);
+        // sizes are stored first so the buffers below never see a reallocation
+        for (const auto& body : _tcpWriteBodies)
+        {
+            _tcpWriteNetSizes.push_back(htonl(static_cast<std::uint32_t>(body->size()))); // 4 byte size Big-Endian
+        }
 
-        if (self->_tcpDataSize > MAX_PACKET_SIZE)
+        for (std::size_t i = 0; i < _tcpWriteBodies.size(); ++i)
         {
-            spdlog::error("{} : TCP error receiving data size ({})", self->_sessionInfo.uid(), self->_tcpDataSize);
-            self->TcpAsyncReadSize();
-            return;
+            _tcpWriteBuffers.push_back(asio::buffer(&_tcpWriteNetSizes[i], sizeof(std::uint32_t)));
+            _tcpWriteBuffers.push_back(asio::buffer(*_tcpWriteBodies[i]));
         }
 
-        const auto dataBuffer = std::make_shared<std::vector<char>>(self->_tcpDataSize, 0);
-        self->TcpAsyncReadData(dataBuffer);
-    }));
+        error_code ec;
+        co_await asio::async_write(*_tcpSocketPtr, _tcpWriteBuffers, asio::redirect_error(USE_SESSION_AWAITABLE, ec));
+        if (ec)
+        {
+            spdlog::error("TCP error sending data to {} : {}", _sessionInfo.uid(), ec.message());
+        }
+    }
 }
 
-void Session::TcpAsyncReadData(std::shared_ptr<std::vector<char>> dataBuffer)
+// every exit stops the session, otherwise the parked writer keeps it alive
+SessionAwaitable<void> Session::TcpReadLoop()
 {
-    auto self(shared_from_this());
-    asio::async_read(*_tcpSocketPtr, asio::buffer(*dataBuffer),
-        asio::bind_executor(_normalPrivateStrand, [self, dataBuffer](const std::error_code& dataEc, std::size_t)
+    // frames that arrived behind the handshake reply (pipelined client) are already in the buffer
+    if (!ProcessTcpFrames())
+        co_return;
+
+    while (true)
     {
-        if (dataEc)
+        const auto ec = co_await TcpReadSome();
+        if (ec)
         {
-            if (dataEc == asio::error::eof
-                || dataEc == asio::error::connection_reset
-                || dataEc == asio::error::connection_aborted
-                || dataEc == asio::error::operation_aborted)
-            {
-                self->Stop(false);
-                return;
-            }
-
-            spdlog::error("{} : TCP error receiving data ({})", self->_sessionInfo.uid(), dataEc.message());
-            self->TcpAsyncReadSize();
-            return;
+            if (ec == asio::error::eof
+                || ec == asio::error::connection_reset
+                || ec == asio::error::connection_aborted
+                || ec == asio::error::operation_aborted)
+                spdlog::info("session {} : TcpReadLoop aborted", _sessionInfo.uid());
+            else
+                spdlog::error("{} : TCP error receiving data ({})", _sessionInfo.uid(), ec.message());
+
+            Stop(false);
+            co_return;
         }
 
-        ConsoleMonitor::Get().IncrementTcpPacket();
+        if (!ProcessTcpFrames())
+            co_return; // broken stream, already stopped
+    }
+}
 
-        RpcPacket deserializeRpcPacket;
-        if (!deserializeRpcPacket.ParseFromArray(dataBuffer->data(), static_cast<int>(dataBuffer->size())))
-        {
-            spdlog::error("{} : error parsing rpc packet", self->_sessionInfo.uid());
-            self->TcpAsyncReadSize();
-            return;
-        }
+SessionAwaitable<error_code> Session::TcpReadSome()
+{
+    if (_tcpReadOffset == _tcpWriteOffset)
+    {
+        _tcpReadOffset = 0;
+        _tcpWriteOffset = 0;
+    }
 
-        const auto packetPtr = std::make_shared<RpcPacket>(deserializeRpcPacket);
-        self->TcpAsyncReadSize();
-        self->ProcessTcpRequest(packetPtr);
-    }));
+    // move the unread bytes to the front when the tail is short, the buffer is reused for the whole session
+    if (_tcpReceiveBuffer.size() - _tcpWriteOffset < TCP_MIN_READ_SIZE && _tcpReadOffset > 0)
+    {
+        std::memmove(_tcpReceiveBuffer.data(), _tcpReceiveBuffer.data() + _tcpReadOffset, _tcpWriteOffset - _tcpReadOffset);
+        _tcpWriteOffset -= _tcpReadOffset;
+        _tcpReadOffset = 0;
+    }
+
+    error_code ec;
+    const auto bytesRead = co_await _tcpSocketPtr->async_read_some(asio::buffer(_tcpReceiveBuffer.data() + _tcpWriteOffset, _tcpReceiveBuffer.size() - _tcpWriteOffset),
+        asio::redirect_error(USE_SESSION_AWAITABLE, ec));
+
+    _tcpWriteOffset += bytesRead;
+    co_return ec;
 }
 
-void Session::AsyncUpdateOwnState()
+Session::TcpFrameResult Session::TakeTcpFrame(std::string_view& body)
 {
-    auto self(shared_from_this());
-    asio::post(_normalPrivateStrand, [self]()
+    // next complete [size(4)][RpcPacket] in the buffer
+    if (_tcpWriteOffset - _tcpReadOffset < sizeof(std::uint32_t))
+        return TcpFrameResult::Partial;
+
+    std::uint32_t netSize;
+    std::memcpy(&netSize, _tcpReceiveBuffer.data() + _tcpReadOffset, sizeof(netSize));
+    const std::size_t dataSize = ntohl(netSize);
+
+    if (dataSize > MAX_PACKET_SIZE)
+    {
+        // the stream cannot be resynchronized after a bad size
+        spdlog::error("{} : TCP error receiving data size ({})", _sessionInfo.uid(), dataSize);
+        return TcpFrameResult::Broken;
+    }
+
+    const std::size_t frameSize = sizeof(std::uint32_t) + dataSize;
+    if (_tcpWriteOffset - _tcpReadOffset < frameSize)
     {
-        std::queue<RpcPacket> localQueue;
+        // partial frame : make sure the whole frame fits, then wait for the rest
+        if (frameSize > _tcpReceiveBuffer.size() - _tcpReadOffset)
         {
-            std::lock_guard<std::mutex> lock(self->_statesQueueMutex);
-            if (self->_statesQueue.empty())
-            {
-                self->_isOwnStateUpdating = false;
-                return;
-            }
+            std::memmove(_tcpReceiveBuffer.data(), _tcpReceiveBuffer.data() + _tcpReadOffset, _tcpWriteOffset - _tcpReadOffset);
+            _tcpWriteOffset -= _tcpReadOffset;
+            _tcpReadOffset = 0;
 
-            // all update packets moved local queue
-            self->_statesQueue.swap(localQueue);
+            if (frameSize > _tcpReceiveBuffer.size())
+                _tcpReceiveBuffer.resize(frameSize);
         }
 
-        // dequeue and process moved local queue
-        while (!localQueue.empty())
-        {
-            const auto nextPacket = localQueue.front();
-            localQueue.pop();
+        return TcpFrameResult::Partial;
+    }
 
-            switch (nextPacket.method())
-            {
-            case RpcMethod::MoveStart:
-            case RpcMethod::Move:
-            case RpcMethod::MoveStop:
-            {
-                MoveData newMoveData;
-                // parsing move data and apply
-                if (!newMoveData.ParseFromString(nextPacket.data()))
-                {
-                    spdlog::error("{} error parsing move data for update own state", self->_sessionInfo.uid());
-                    return;
-                }
-
-                std::lock_guard<std::mutex> stateLock(self->_stateMutex);
-                self->_userState.position.SetPosition(newMoveData.x(), newMoveData.y(), newMoveData.z());
-                break;
-            }
-            case RpcMethod::Hit:
-            {
-                // 값 만큼 hp 감소
-                std::int32_t value = stoi(nextPacket.data());
-
-                if (value < 0)
-                {
-                    spdlog::error("[internal] invalid value from hit damage: {}, owner: {}", value, nextPacket.uid());
-                    break;
-                }
-
-                std::lock_guard<std::mutex> stateLock(self->_stateMutex);
-                self->_userState.hp -= value;
-                break;
-            }
-            default:
-                spdlog::error("{} invalid method in update state: {}", self->_sessionInfo.uid(), Util::MethodToString(nextPacket.method()));
-                break;
-            }
-        }
+    body = std::string_view(_tcpReceiveBuffer.data() + _tcpReadOffset + sizeof(std::uint32_t), dataSize);
+    _tcpReadOffset += frameSize;
+    return TcpFrameResult::Frame;
+}
+
+bool Session::ProcessTcpFrames()
+{
+    // every complete frame in the buffer, parsed in place
+    std::string_view body;
+    auto result = TakeTcpFrame(body);
+    for (; result == TcpFrameResult::Frame; result = TakeTcpFrame(body))
+    {
+        ConsoleMonitor::Get().IncrementTcpPacket();
 
-        std::lock_guard<std::mutex> lock(self->_statesQueueMutex);
-        if (self->_statesQueue.empty())
+        // control packets fit in the stack block, the arena frees everything at scope exit
+        alignas(std::max_align_t) char arenaBlock[PARSE_ARENA_BLOCK_SIZE];
+        google::protobuf::Arena parseArena(arenaBlock, sizeof(arenaBlock));
+        auto* deserializeRpcPacket = google::protobuf::Arena::Create<RpcPacket>(&parseArena);
+        if (!deserializeRpcPacket->ParseFromArray(body.data(), static_cast<int>(body.size())))
         {
-            self->_isOwnStateUpdating = false;
-            return;
+            spdlog::error("{} : error parsing rpc packet", _sessionInfo.uid());
+            continue;
         }
 
-        // if queue is not empty -> re process
-        asio::post(self->_normalPrivateStrand, [self]() { self->AsyncUpdateOwnState(); });
-    });
+        ProcessTcpRequest(*deserializeRpcPacket);
+    }
+
+    if (result == TcpFrameResult::Broken)
+    {
+        Stop(false);
+        return false;
+    }
+
+    return true;
 }
 
 void Session::SendGameStatePacket(CompletionHandler onComplete)
@@ -680,8 +783,8 @@ void Session::SendGameStatePacket(CompletionHandler onComplete)
     auto serializedGameData = gameData.SerializeAsString();
     packet.set_data(serializedGameData);
 
-    const auto serializedPacket = std::make_shared<std::string>(packet.SerializeAsString());
-    EnqueueTcpSendData(std::move(serializedPacket));
+    auto serializedPacket = std::make_shared<std::string>(packet.SerializeAsString());
+    EnqueueTcpStateData(std::move(serializedPacket));
 
     onComplete(); // call again this function by scheduler
 }
\ No newline at end of file
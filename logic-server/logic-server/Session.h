@@ -1,17 +1,24 @@
 #pragma once
 
 #include <asio.hpp>
+#include <google/protobuf/arena.h>
 #include <stduuid/uuid.h>
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/basic_file_sink.h>
 
 #include <memory>
 #include <queue>
+#include <deque>
+#include <string_view>
 
 #include "Base.h"
 #include "Scheduler.h"
 #include "NetworkData.pb.h"
 #include "Util.h"
+#include "NetworkProtocol.h"
+#include "TokenBucket.h"
+#include "UdpFrame.h"
+#include "SeqlockCell.h"
 
 using namespace NetworkData;
 
@@ -21,6 +28,11 @@ using asio::ip::tcp;
 using asio::ip::udp;
 using uuids::uuid;
 
+// session coroutines run on the session strand (io_context::strand is not an any_io_executor)
+template <typename T>
+using SessionAwaitable = asio::awaitable<T, IoContext::strand>;
+constexpr asio::use_awaitable_t<IoContext::strand> USE_SESSION_AWAITABLE{};
+
 class Server;
 class LockstepGroup;
 class Scheduler;
@@ -30,6 +42,9 @@ struct SSendPacket;
 
 constexpr std::int64_t INVALID_RTT = -1;
 constexpr std::size_t MAX_PACKET_SIZE = 65535;
+constexpr std::size_t TCP_RECEIVE_BUFFER_SIZE = 4096; // initial receive buffer, grows once for a bigger frame
+constexpr std::size_t TCP_MIN_READ_SIZE = 512; // unread bytes are moved to the front when less room is left
+constexpr std::size_t PARSE_ARENA_BLOCK_SIZE = 512; // stack block for short-lived parse arenas
 
 class Session final : public Base<Session>
 {
@@ -49,43 +64,121 @@ public:
     tcp::socket& GetSocket() const { return *_tcpSocketPtr; }
 
 public: // first handshaking functions
-    bool ExchangeUdpPort(std::uint16_t udpPort);
-    void AsyncExchangeUdpPortWork(std::uint16_t udpPort, std::function<void(bool success)> onComplete);
-
-    bool ReceiveUserInfo();
-    void AsyncReceiveUserInfo(std::function<void(bool success)> onComplete);
-
-    bool ReceiveGroupInfo(std::shared_ptr<GroupDto>& groupInfo);
-    void AsyncReceiveGroupInfo(std::function<void(bool success, std::shared_ptr<GroupDto> groupInfo)> onComplete);
+    // UDP_PORT (-> UDP_PORT accept) -> USER_INFO -> GROUP_INFO as a coroutine on _normalPrivateStrand, then the same coroutine becomes the tcp read loop
+    // every step sends a prompt through the tcp writer and waits for the reply within _handshakeStepTimeout
+    // returns true once the session joined its group, false fails the handshake
+    using HandshakeHandler = std::function<bool(bool success, std::shared_ptr<GroupDto> groupInfo)>;
+    void AsyncHandshake(std::uint16_t udpPort, HandshakeHandler onComplete);
+
+private: // handshake coroutines
+    SessionAwaitable<void> RunSession(std::shared_ptr<Session> self, std::uint16_t udpPort); // self keeps the session alive for the frame
+    SessionAwaitable<bool> RunHandshake(std::uint16_t udpPort);
+    SessionAwaitable<bool> ReadHandshakeReply(RpcMethod method, RpcPacket& reply);
+
+    void SendHandshakePrompt(RpcMethod method, std::string data);
+    void SendUdpPortAccept();
+    bool FinishHandshake(bool success); // false : handshake failed or the group refused the session
+
+    bool ApplyUdpPortReply(const RpcPacket& packet);
+    bool ApplyUserInfoReply(const RpcPacket& packet);
+    bool ApplyGroupInfoReply(const RpcPacket& packet);
+    bool ApplyHelloReply(const RpcPacket& packet);
+
+    bool ApplyUserInfo(const std::string& uid, std::string_view username);
+    bool ApplyGroupInfo(std::string_view groupData);
+
+    HandshakeHandler _onHandshakeComplete;
+    std::shared_ptr<asio::steady_timer> _handshakeTimer;
+    const std::chrono::milliseconds _handshakeStepTimeout = std::chrono::milliseconds(5000);
+    std::string _connectedIp;
 
 private: // internal private functions
-    void SerializeRpcPacketAndEnqueueData();
-    RpcPacket DequeueSendUdpPackets();
+    void FlushSendUdpFrames();
 
     void SendPingPacket(CompletionHandler onComplete);
-    void ProcessTcpRequest(const std::shared_ptr<RpcPacket> packet);
+    void ProcessTcpRequest(const RpcPacket& packet);
 
 public: // default session functions
     bool IsValid() const { return _isConnected; }
-    uuid GetSessionUuid() const { return *uuid::from_string(_sessionInfo.uid()); }
+    uuid GetSessionUuid() const { return _sessionUuid; }
+    const std::string& GetSessionUid() const { return _sessionInfo.uid(); }
+    const udp::endpoint& GetUdpEndpoint() const { return _udpSendEp; }
+
+    // udp token issued by server before the handshake
+    void SetUdpToken(std::uint32_t token) { _udpToken = token; }
+    std::uint32_t GetUdpToken() const { return _udpToken; }
+    bool HasCapability(std::uint32_t capability) const { return (_clientCapabilities & capability) != 0; }
+    std::uint64_t GetLastRtt() const { return _lastRtt.load(std::memory_order_relaxed); }
+
+    // pending tcp messages (queue + coalesced state), slow consumers grow this
+    std::size_t GetTcpSendQueueDepth() const { return _tcpSendQueueDepth.load(std::memory_order_relaxed); }
+
+    // udp ingress limit, checked by the server before a datagram is parsed
+    void SetUdpIngressLimit(double ratePerSecond, double burst) { _udpIngressBucket.Configure(ratePerSecond, burst); }
+    bool TryConsumeUdpIngress(TokenBucket::Clock::time_point now) { return _udpIngressBucket.TryConsume(now); }
 
-    void CollectInput(std::shared_ptr<RpcPacket> receivePacket);
-    void EnqueueSendUdpPackets(const std::list<std::shared_ptr<SSendPacket>> sendPackets);
+    void CollectInput(std::shared_ptr<SSendPacket> input);
+    void EnqueueSendUdpFrames(std::shared_ptr<const UdpFrameList> frames);
 
 private: // tcp functions
     std::mutex _sendTcpQueueMutex;
     std::queue<std::shared_ptr<std::string>> _sendTcpQueue;
 
     void EnqueueTcpSendData(std::shared_ptr<std::string> data); // tcp data for sent to client
-    void TcpAsyncWrite(); // Tcp data must be sent through this function
-	void TcpAsyncReadSize();
-    void TcpAsyncReadData(std::shared_ptr<std::vector<char>> dataBuffer);
+    void EnqueueTcpStateData(std::shared_ptr<std::string> data); // CLIENT_GAME_INFO, only the newest unsent snapshot is kept
+    void SignalTcpWriter(); // _sendTcpQueueMutex must be held
+
+    // bounded control channel : more than _tcpSendQueueHardCap pending messages means the client stopped reading
+    const std::size_t _tcpSendQueueHardCap = 64; // ~1 min of PING at 1s once the game state is coalesced
+    const std::size_t _tcpSendQueueWarnDepth = 8; // logged with the uid on every ping while reached
+    std::shared_ptr<std::string> _pendingTcpState;
+    std::atomic<std::size_t> _tcpSendQueueDepth = 0;
+    bool _isTcpSendOverflowed = false;
+    SessionAwaitable<void> TcpWriteLoop(std::shared_ptr<Session> self); // Tcp data must be sent through this coroutine
+
+    // writer parks on _tcpWriteSignal (never expires) when the queue is empty, cancel wakes it up
+    std::shared_ptr<asio::steady_timer> _tcpWriteSignal;
+    std::atomic<bool> _isTcpWriterStopped = false;
+
+    // gathered write : every pending [size(4)][body] up to _tcpWriteByteCap in one async_write
+    // owned by the writer loop, reused between writes
+    const std::size_t _tcpWriteByteCap = 64 * 1024;
+    std::vector<std::uint32_t> _tcpWriteNetSizes;
+    std::vector<std::shared_ptr<std::string>> _tcpWriteBodies;
+    std::vector<asio::const_buffer> _tcpWriteBuffers;
+
+    // streaming read : one async_read_some, then every complete frame is processed
+    enum class TcpFrameResult : std::uint8_t
+    {
+        Frame,
+        Partial,
+        Broken
+    };
+
+    SessionAwaitable<void> TcpReadLoop();
+    SessionAwaitable<error_code> TcpReadSome();
+    TcpFrameResult TakeTcpFrame(std::string_view& body); // body points into _tcpReceiveBuffer until the next read
+    bool ProcessTcpFrames(); // false : stream is broken, session stopped
 
 private: // udp network members
     std::mutex _sendUdpQueueMutex;
-    std::queue<RpcPacket> _sendUdpPacketQueue;
+    std::queue<std::shared_ptr<const UdpFrameList>> _sendUdpFrameQueue;
     bool _isTcpSending = false;
-    bool _isSerializingUdp = false;
+    bool _isFlushingUdp = false;
+
+private: // udp egress pacing, rpc strand only
+    // opt-in, pacing is only an offset : the frames of a tick are held until the session's own slot inside the tick window
+    // so a group does not burst all members at once, then everything queued goes out together (High frames first)
+    // it never limits the throughput, but adds up to TICK_TIME of latency to every datagram
+    void PaceUdpFrame(std::shared_ptr<const UdpFrame> frame);
+    void ArmUdpPacing(std::chrono::microseconds delay);
+    void ReleasePacedUdpFrames();
+
+    const bool _useUdpPacing = false;
+    std::shared_ptr<asio::steady_timer> _udpPacingTimer;
+    std::deque<std::shared_ptr<const UdpFrame>> _pacedHighFrames;
+    std::deque<std::shared_ptr<const UdpFrame>> _pacedFrames;
+    bool _isPacingArmed = false;
 
 private: // default members
     using TcpSocket = tcp::socket;
@@ -102,32 +195,40 @@ private: // default members
     std::shared_ptr<UdpSocket> _udpSocketPtr;
     udp::endpoint _udpSendEp;
 
-    // tcp net size cache
-    std::uint32_t _tcpNetSize = 0;
-    std::uint32_t _tcpDataSize = 0;
+    // tcp receive buffer : [_tcpReadOffset, _tcpWriteOffset) holds received, unprocessed bytes
+    std::vector<char> _tcpReceiveBuffer;
+    std::size_t _tcpReadOffset = 0;
+    std::size_t _tcpWriteOffset = 0;
 
     // client connected state
     std::atomic<bool> _isConnected = false;
 
     // dtos
     UserSimpleDto _sessionInfo;
+    uuid _sessionUuid;
     GroupDto _groupDto;
 
+    // negotiated in the UDP_PORT step of the handshake
+    std::uint32_t _udpToken = NetworkProtocol::INVALID_SESSION_TOKEN;
+    std::uint32_t _clientCapabilities = NetworkProtocol::CAPABILITY_NONE;
+    bool _isCapabilityOffered = false; // false : legacy client, never sent anything but the 2-byte port
+    TokenBucket _udpIngressBucket;
+
 private: // rtt timer
     std::shared_ptr<Scheduler> _pingTimer;
     const std::uint32_t _pingDelay = 1000;
     std::chrono::high_resolution_clock::time_point _pingTime;
-    std::uint64_t _lastRtt;
+    std::atomic<std::uint64_t> _lastRtt; // ms, read by the group for lag compensation
 
 public: // callback functions 
     using StopCallback = std::function<void(const std::shared_ptr<Session>&)>;
     void SetStopCallbackByGroup(StopCallback stopCallback);
     void SetStopCallbackByServer(StopCallback stopCallback);
 
-    using SessionInput = std::function<void(std::shared_ptr<std::pair<uuid, std::shared_ptr<RpcPacket>>>)>;
+    using SessionInput = std::function<void(const std::shared_ptr<SSendPacket>&)>;
     void SetCollectInputAction(SessionInput inputAction);
 
-    using SendDataByUdp = std::function<void(std::shared_ptr<std::pair<udp::endpoint, std::string>>)>;
+    using SendDataByUdp = std::function<void(SUdpSendData)>;
     void SetSendDataByUdpAction(SendDataByUdp sendDataFunction);
 
 private: // callback handlers
@@ -137,14 +238,8 @@ private: // callback handlers
     SendDataByUdp _sendDataByUdp;
 
 private: // own state
-    mutable std::mutex _stateMutex;
-    Util::SUserState _userState;
-
-    // update SUserState(_userState)
-    std::mutex _statesQueueMutex;
-    std::queue<RpcPacket> _statesQueue;
-    bool _isOwnStateUpdating = false;
-    void AsyncUpdateOwnState();
+    // snapshot published by the group strand after each tick, read from any thread without lock
+    SeqlockCell<Util::SUserState> _gameState;
 
     // call SendGameStatePacket() per _sendStateDelay
     std::shared_ptr<Scheduler> _sendStateTimer;
@@ -154,9 +249,6 @@ private: // own state
     void SendGameStatePacket(CompletionHandler onComplete);
 
 public:
-    Util::SUserState GetGameState() const 
-    {
-        std::lock_guard<std::mutex> lock(_stateMutex);
-        return _userState; 
-    }
+    void PublishGameState(const Util::SUserState& gameState) { _gameState.Store(gameState); } // group strand only
+    Util::SUserState GetGameState() const { return _gameState.Load(); }
 };
\ No newline at end of file
@@ -0,0 +1,250 @@
+#include "SessionDirectory.h"
+
+#include "Session.h"
+#include "NetworkProtocol.h"
+
+#include <algorithm>
+
+SessionDirectory::SessionDirectory()
+    : _snapshot(new SSnapshot()),
+    _tokenSlots(std::make_unique<std::atomic<Session*>[]>(MAX_TOKEN_SLOTS)),
+    _tokenGenerations(MAX_TOKEN_SLOTS, 0)
+{
+    // slot 0 with generation 0 would be INVALID_SESSION_TOKEN, so slot 0 is never issued
+    _freeTokenSlots.reserve(MAX_TOKEN_SLOTS - 1);
+    for (std::size_t slot = MAX_TOKEN_SLOTS - 1; slot > 0; --slot)
+    {
+        _freeTokenSlots.push_back(static_cast<std::uint16_t>(slot));
+    }
+}
+
+SessionDirectory::~SessionDirectory()
+{
+    delete _snapshot.load(std::memory_order_acquire);
+}
+
+void SessionDirectory::RegisterReader(SReader& reader)
+{
+    std::lock_guard<std::mutex> lock(_writeMutex);
+    _readers.push_back(&reader);
+}
+
+// announce the version before using anything of it, and retry until no writer bumped it meanwhile
+// a writer that bumps later sees the announcement, one that bumped earlier already cleared what it retired
+void SessionDirectory::EnterRead(SReader& reader)
+{
+    std::uint64_t version = _version.load(std::memory_order_seq_cst);
+    for (;;)
+    {
+        reader.observedVersion.store(version, std::memory_order_seq_cst);
+        const std::uint64_t currentVersion = _version.load(std::memory_order_seq_cst);
+        if (currentVersion == version)
+            break;
+
+        version = currentVersion;
+    }
+
+    if (reader.snapshotVersion != version)
+    {
+        reader.snapshot = _snapshot.load(std::memory_order_acquire);
+        reader.snapshotVersion = version;
+    }
+}
+
+void SessionDirectory::LeaveRead(SReader& reader)
+{
+    reader.observedVersion.store(READER_OFFLINE, std::memory_order_release);
+
+    // no writer may come for a long time, the last reader out frees what it was holding back
+    if (_hasRetired.load(std::memory_order_relaxed))
+    {
+        std::unique_lock<std::mutex> lock(_writeMutex, std::try_to_lock);
+        if (lock.owns_lock())
+            ReclaimRetired();
+    }
+}
+
+std::size_t SessionDirectory::Add(const std::shared_ptr<Session>& session)
+{
+    std::lock_guard<std::mutex> lock(_writeMutex);
+    auto newSnapshot = CopySnapshot();
+    newSnapshot->sessions[session->GetSessionUuid()] = session;
+
+    const std::size_t sessionCount = newSnapshot->sessions.size();
+    Publish(std::move(newSnapshot));
+
+    // the slot is filled once a snapshot owns the session
+    const std::uint32_t token = session->GetUdpToken();
+    if (token != NetworkProtocol::INVALID_SESSION_TOKEN)
+        _tokenSlots[token & 0xFFFF].store(session.get(), std::memory_order_seq_cst);
+
+    return sessionCount;
+}
+
+std::size_t SessionDirectory::Remove(const uuid& sessionId)
+{
+    std::lock_guard<std::mutex> lock(_writeMutex);
+    auto newSnapshot = CopySnapshot();
+
+    const auto sessionIt = newSnapshot->sessions.find(sessionId);
+    if (sessionIt != newSnapshot->sessions.end())
+    {
+        // slot is cleared before the version moves on, readers entering the new version never find it
+        Session* session = sessionIt->second.get();
+        ReleaseTokenSlot(session->GetUdpToken());
+
+        // learned endpoints are not always the reported one
+        std::erase_if(newSnapshot->endpoints, [session](const auto& entry) { return entry.second == session; });
+
+        newSnapshot->sessions.erase(sessionIt);
+    }
+
+    const std::size_t sessionCount = newSnapshot->sessions.size();
+    Publish(std::move(newSnapshot));
+    return sessionCount;
+}
+
+Session* SessionDirectory::Find(const SReader& reader, const uuid& sessionId) const
+{
+    const auto& sessions = reader.snapshot->sessions;
+    const auto sessionIt = sessions.find(sessionId);
+    if (sessionIt == sessions.end())
+        return nullptr;
+
+    return sessionIt->second.get();
+}
+
+Session* SessionDirectory::FindByEndpoint(const SReader& reader, const udp::endpoint& endpoint) const
+{
+    const auto& endpoints = reader.snapshot->endpoints;
+    const auto endpointIt = endpoints.find(endpoint);
+    if (endpointIt == endpoints.end())
+        return nullptr;
+
+    return endpointIt->second;
+}
+
+void SessionDirectory::LearnEndpoint(const SReader& reader, const udp::endpoint& endpoint, Session* session)
+{
+    // steady state : already indexed or contested, no lock
+    {
+        const auto& snapshot = *reader.snapshot;
+        const auto endpointIt = snapshot.endpoints.find(endpoint);
+        if ((endpointIt != snapshot.endpoints.end() && endpointIt->second == session) || snapshot.contestedEndpoints.contains(endpoint))
+            return;
+    }
+
+    std::lock_guard<std::mutex> lock(_writeMutex);
+    auto newSnapshot = CopySnapshot();
+    if (!newSnapshot->sessions.contains(session->GetSessionUuid()) || newSnapshot->contestedEndpoints.contains(endpoint))
+        return;
+
+    const auto endpointIt = newSnapshot->endpoints.find(endpoint);
+    if (endpointIt != newSnapshot->endpoints.end() && endpointIt->second == session)
+        return;
+
+    // shared NAT port or loopback clients : nobody owns the endpoint, the uid decides
+    if (endpointIt != newSnapshot->endpoints.end())
+        ContestEndpoint(*newSnapshot, endpoint);
+    else
+        newSnapshot->endpoints.emplace(endpoint, session);
+
+    Publish(std::move(newSnapshot));
+}
+
+void SessionDirectory::ContestEndpoint(const udp::endpoint& endpoint)
+{
+    std::lock_guard<std::mutex> lock(_writeMutex);
+    auto newSnapshot = CopySnapshot();
+    ContestEndpoint(*newSnapshot, endpoint);
+    Publish(std::move(newSnapshot));
+}
+
+// _writeMutex must be held
+void SessionDirectory::ContestEndpoint(SSnapshot& snapshot, const udp::endpoint& endpoint)
+{
+    snapshot.endpoints.erase(endpoint);
+
+    // bounded, a forgotten endpoint is contested again by its next collision
+    if (snapshot.contestedEndpoints.size() >= MAX_CONTESTED_ENDPOINTS)
+        snapshot.contestedEndpoints.clear();
+
+    snapshot.contestedEndpoints.insert(endpoint);
+}
+
+// _writeMutex must be held
+std::unique_ptr<SessionDirectory::SSnapshot> SessionDirectory::CopySnapshot() const
+{
+    return std::make_unique<SSnapshot>(*_snapshot.load(std::memory_order_acquire));
+}
+
+// _writeMutex must be held
+void SessionDirectory::Publish(std::unique_ptr<SSnapshot> newSnapshot)
+{
+    const SSnapshot* oldSnapshot = _snapshot.exchange(newSnapshot.release(), std::memory_order_seq_cst);
+    const std::uint64_t version = _version.fetch_add(1, std::memory_order_seq_cst) + 1;
+
+    _retiredSnapshots.emplace_back(version, std::unique_ptr<const SSnapshot>(oldSnapshot));
+    _hasRetired.store(true, std::memory_order_relaxed);
+    ReclaimRetired();
+}
+
+// _writeMutex must be held
+void SessionDirectory::ReclaimRetired()
+{
+    std::uint64_t oldestObserved = READER_OFFLINE;
+    for (const auto* reader : _readers)
+    {
+        oldestObserved = std::min(oldestObserved, reader->observedVersion.load(std::memory_order_seq_cst));
+    }
+
+    // a reader inside version v only holds snapshots of v or later
+    std::erase_if(_retiredSnapshots, [oldestObserved](const auto& retired) { return retired.first <= oldestObserved; });
+    _hasRetired.store(!_retiredSnapshots.empty(), std::memory_order_relaxed);
+}
+
+std::uint32_t SessionDirectory::IssueToken()
+{
+    std::lock_guard<std::mutex> lock(_writeMutex);
+    if (_freeTokenSlots.empty())
+        return NetworkProtocol::INVALID_SESSION_TOKEN;
+
+    const std::uint16_t slot = _freeTokenSlots.back();
+    _freeTokenSlots.pop_back();
+
+    // a new generation per issue, so a stale token of the previous owner never resolves
+    const std::uint16_t generation = ++_tokenGenerations[slot];
+    return (static_cast<std::uint32_t>(generation) << 16) | slot;
+}
+
+void SessionDirectory::ReleaseToken(std::uint32_t token)
+{
+    std::lock_guard<std::mutex> lock(_writeMutex);
+    ReleaseTokenSlot(token);
+}
+
+// _writeMutex must be held
+void SessionDirectory::ReleaseTokenSlot(std::uint32_t token)
+{
+    if (token == NetworkProtocol::INVALID_SESSION_TOKEN)
+        return;
+
+    const std::uint16_t slot = static_cast<std::uint16_t>(token & 0xFFFF);
+    const std::uint16_t generation = static_cast<std::uint16_t>(token >> 16);
+    if (_tokenGenerations[slot] != generation)
+        return;
+
+    _tokenSlots[slot].store(nullptr, std::memory_order_seq_cst);
+    ++_tokenGenerations[slot]; // released token never matches again
+    _freeTokenSlots.push_back(slot);
+}
+
+// inside a read section : the slot owner is kept alive by a snapshot the reader may still hold
+Session* SessionDirectory::FindByToken(std::uint32_t token) const
+{
+    Session* session = _tokenSlots[token & 0xFFFF].load(std::memory_order_seq_cst);
+    if (session == nullptr || session->GetUdpToken() != token)
+        return nullptr;
+
+    return session;
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include <asio.hpp>
+#include <stduuid/uuid.h>
+
+using uuids::uuid;
+using asio::ip::udp;
+
+class Session;
+
+struct SEndpointHash
+{
+    std::size_t operator()(const udp::endpoint& endpoint) const
+    {
+        const std::size_t addressHash = endpoint.address().is_v4()
+            ? std::hash<std::uint32_t>()(endpoint.address().to_v4().to_uint())
+            : std::hash<std::string>()(endpoint.address().to_string());
+        return addressHash ^ (static_cast<std::size_t>(endpoint.port()) << 1);
+    }
+};
+
+// read-mostly session lookup for the udp demux
+// writers copy the maps and publish a new immutable snapshot, readers never take a lock or touch a refcount
+// udp tokens index a fixed slot table directly : token = (generation << 16) | slot
+//
+// reclaim : snapshots and token slots hold raw pointers, a replaced snapshot (and the sessions only it owns)
+// is freed once every registered reader has entered a later version or is outside its read section
+class SessionDirectory
+{
+public:
+    using SessionMap = std::unordered_map<uuid, std::shared_ptr<Session>>;
+    using EndpointMap = std::unordered_map<udp::endpoint, Session*, SEndpointHash>; // owned by sessions of the same snapshot
+    using EndpointSet = std::unordered_set<udp::endpoint, SEndpointHash>;
+
+    struct SSnapshot
+    {
+        SessionMap sessions;
+        EndpointMap endpoints; // keyed by udp endpoint observed on a verified datagram of the session
+        EndpointSet contestedEndpoints; // claimed by two sessions, never indexed again
+    };
+
+    static constexpr std::size_t MAX_CONTESTED_ENDPOINTS = 4096;
+    static constexpr std::size_t MAX_TOKEN_SLOTS = 1 << 16;
+    static constexpr std::uint64_t READER_OFFLINE = UINT64_MAX;
+
+    // one per reading strand (udp shard), pointers found inside a read section stay valid until it ends
+    struct alignas(64) SReader
+    {
+        std::atomic<std::uint64_t> observedVersion = READER_OFFLINE;
+        const SSnapshot* snapshot = nullptr; // cached, reloaded when the version changes
+        std::uint64_t snapshotVersion = READER_OFFLINE;
+    };
+
+    // read section of one batch
+    class ReadGuard
+    {
+    public:
+        ReadGuard(SessionDirectory& directory, SReader& reader) : _directory(directory), _reader(reader) { _directory.EnterRead(_reader); }
+        ~ReadGuard() { _directory.LeaveRead(_reader); }
+
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+    private:
+        SessionDirectory& _directory;
+        SReader& _reader;
+    };
+
+    SessionDirectory();
+    ~SessionDirectory();
+
+    SessionDirectory(const SessionDirectory&) = delete;
+    SessionDirectory& operator=(const SessionDirectory&) = delete;
+
+    // before the reader starts reading, the reader must outlive the directory's use
+    void RegisterReader(SReader& reader);
+
+    // return session count after the change
+    std::size_t Add(const std::shared_ptr<Session>& session);
+    std::size_t Remove(const uuid& sessionId);
+
+    // inside a read section of reader only
+    Session* Find(const SReader& reader, const uuid& sessionId) const;
+    Session* FindByEndpoint(const SReader& reader, const udp::endpoint& endpoint) const;
+    Session* FindByToken(std::uint32_t token) const;
+
+    // endpoint seen on a verified datagram of the session, a second owner removes the entry for good
+    void LearnEndpoint(const SReader& reader, const udp::endpoint& endpoint, Session* session);
+    // endpoint routed a datagram of another session
+    void ContestEndpoint(const udp::endpoint& endpoint);
+
+    // reserve a token at handshake, it resolves only after Add() and is freed by Remove() or ReleaseToken()
+    std::uint32_t IssueToken();
+    void ReleaseToken(std::uint32_t token);
+
+private:
+    std::mutex _writeMutex;
+    std::atomic<const SSnapshot*> _snapshot;
+    std::atomic<std::uint64_t> _version = 0;
+
+    // replaced snapshots with the version that replaced them (guarded by _writeMutex)
+    std::vector<std::pair<std::uint64_t, std::unique_ptr<const SSnapshot>>> _retiredSnapshots;
+    std::atomic<bool> _hasRetired = false;
+    std::vector<SReader*> _readers;
+
+    // token slots (_freeTokenSlots and _tokenGenerations are guarded by _writeMutex)
+    std::unique_ptr<std::atomic<Session*>[]> _tokenSlots;
+    std::vector<std::uint16_t> _tokenGenerations;
+    std::vector<std::uint16_t> _freeTokenSlots;
+
+    void EnterRead(SReader& reader);
+    void LeaveRead(SReader& reader);
+
+    // _writeMutex must be held
+    std::unique_ptr<SSnapshot> CopySnapshot() const;
+    void Publish(std::unique_ptr<SSnapshot> newSnapshot);
+    void ReclaimRetired();
+    void ReleaseTokenSlot(std::uint32_t token);
+    void ContestEndpoint(SSnapshot& snapshot, const udp::endpoint& endpoint);
+};
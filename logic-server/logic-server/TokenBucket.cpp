@@ -0,0 +1,38 @@
+#include "TokenBucket.h"
+
+#include <algorithm>
+
+TokenBucket::TokenBucket(double ratePerSecond, double burst)
+{
+    Configure(ratePerSecond, burst);
+}
+
+void TokenBucket::Configure(double ratePerSecond, double burst)
+{
+    const double intervalNs = ratePerSecond > 0.0 ? 1e9 / ratePerSecond : 0.0;
+    _intervalNs.store(static_cast<std::int64_t>(intervalNs), std::memory_order_relaxed);
+    _toleranceNs.store(static_cast<std::int64_t>(intervalNs * (std::max(burst, 1.0) - 1.0)), std::memory_order_relaxed);
+    _arrivalNs.store(0, std::memory_order_relaxed); // start full, a fresh sender may burst right away
+}
+
+bool TokenBucket::TryConsume(Clock::time_point now)
+{
+    const std::int64_t intervalNs = _intervalNs.load(std::memory_order_relaxed);
+    if (intervalNs <= 0)
+        return true;
+
+    const std::int64_t toleranceNs = _toleranceNs.load(std::memory_order_relaxed);
+    const std::int64_t nowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+
+    std::int64_t arrivalNs = _arrivalNs.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        // more than burst tokens spent ahead of the refill
+        const std::int64_t startNs = std::max(arrivalNs, nowNs);
+        if (startNs - nowNs > toleranceNs)
+            return false;
+
+        if (_arrivalNs.compare_exchange_weak(arrivalNs, startNs + intervalNs, std::memory_order_relaxed))
+            return true;
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// ingress rate limiter, refilled lazily from the time of each request
+// kept as one theoretical arrival time (GCRA) so a request is a single CAS, no lock on the packet path
+// rate 0 : unlimited
+class TokenBucket
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TokenBucket() = default;
+    TokenBucket(double ratePerSecond, double burst);
+
+    TokenBucket(const TokenBucket&) = delete;
+    TokenBucket& operator=(const TokenBucket&) = delete;
+
+    void Configure(double ratePerSecond, double burst);
+    bool TryConsume(Clock::time_point now);
+
+private:
+    std::atomic<std::int64_t> _intervalNs = 0; // time one token takes to refill, 0 : unlimited
+    std::atomic<std::int64_t> _toleranceNs = 0; // how far ahead of now the arrival time may run (burst - 1 tokens)
+    std::atomic<std::int64_t> _arrivalNs = 0; // theoretical arrival time of the next request, in the past : bucket is full
+};
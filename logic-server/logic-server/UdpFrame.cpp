@@ -0,0 +1,69 @@
+#include "UdpFrame.h"
+
+#include <algorithm>
+#include <cstring>
+
+std::shared_ptr<const UdpFrame> UdpFrame::Serialize(const google::protobuf::MessageLite& message, Priority priority)
+{
+    // bit 15 of the prefix marks a bundle for bundle capable clients, a plain frame must stay below it
+    const std::size_t payloadSize = message.ByteSizeLong();
+    if (payloadSize > NetworkProtocol::UDP_SIZE_MASK)
+        return nullptr;
+
+    std::shared_ptr<UdpFrame> frame(new UdpFrame());
+    frame->_storage.resize(HEADROOM + payloadSize);
+    frame->_priority = priority;
+
+    // serialize straight behind the headroom, no copy afterwards
+    auto* payload = reinterpret_cast<std::uint8_t*>(frame->_storage.data() + HEADROOM);
+    if (message.SerializeWithCachedSizesToArray(payload) != payload + payloadSize)
+        return nullptr;
+
+    const std::uint16_t netSize = htons(static_cast<std::uint16_t>(payloadSize));
+    std::memcpy(frame->_storage.data(), &netSize, sizeof(netSize));
+    return frame;
+}
+
+UdpFrameList UdpFrame::Bundle(const UdpFrameList& frames, std::size_t mtu)
+{
+    const std::size_t bundleBodyLimit = std::min<std::size_t>(mtu - HEADROOM, NetworkProtocol::UDP_SIZE_MASK);
+
+    UdpFrameList bundles;
+    std::shared_ptr<UdpFrame> bundle;
+
+    auto closeBundle = [&bundle, &bundles]()
+    {
+        const std::uint16_t netSize = htons(static_cast<std::uint16_t>((bundle->_storage.size() - HEADROOM) | NetworkProtocol::UDP_BUNDLE_FLAG));
+        std::memcpy(bundle->_storage.data(), &netSize, sizeof(netSize));
+        bundles.push_back(std::move(bundle));
+    };
+
+    for (const auto& frame : frames)
+    {
+        // a frame is already a bundle record : [size(2)][RpcPacket]
+        if (frame->Size() > bundleBodyLimit)
+        {
+            bundles.push_back(frame);
+            continue;
+        }
+
+        if (bundle != nullptr && bundle->_storage.size() - HEADROOM + frame->Size() > bundleBodyLimit)
+            closeBundle();
+
+        if (bundle == nullptr)
+        {
+            bundle.reset(new UdpFrame());
+            bundle->_storage.reserve(HEADROOM + bundleBodyLimit);
+            bundle->_storage.resize(HEADROOM);
+        }
+
+        bundle->_storage.append(frame->Data(), frame->Size());
+        if (frame->GetPriority() == Priority::High)
+            bundle->_priority = Priority::High;
+    }
+
+    if (bundle != nullptr)
+        closeBundle();
+
+    return bundles;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <asio.hpp>
+#include <google/protobuf/message_lite.h>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "NetworkProtocol.h"
+
+class UdpFrame;
+
+// frames of one lockstep tick, serialized once and shared by every member
+using UdpFrameList = std::vector<std::shared_ptr<const UdpFrame>>;
+
+// serialized udp datagram : [size(2)][payload], the size prefix is written into reserved headroom
+// immutable once built, every datagram carrying it shares the same storage
+class UdpFrame
+{
+public:
+    static constexpr std::size_t HEADROOM = sizeof(std::uint16_t);
+
+    // send order inside one paced release
+    enum class Priority : std::uint8_t
+    {
+        Normal,
+        High
+    };
+
+    // nullptr when serialization fails or the payload is over UDP_SIZE_MASK (bit 15 of the prefix is the bundle flag)
+    static std::shared_ptr<const UdpFrame> Serialize(const google::protobuf::MessageLite& message, Priority priority = Priority::Normal);
+
+    // packs frames in order into bundles of at most mtu bytes, a frame that never fits is kept as it is
+    // a bundle is High when any of its frames is
+    static UdpFrameList Bundle(const UdpFrameList& frames, std::size_t mtu);
+
+    // [prefix, payload] const buffer sequence over the shared storage
+    std::array<asio::const_buffer, 2> Buffers() const
+    {
+        return { asio::buffer(_storage.data(), HEADROOM), asio::buffer(_storage.data() + HEADROOM, _storage.size() - HEADROOM) };
+    }
+
+    const char* Data() const { return _storage.data(); }
+    std::size_t Size() const { return _storage.size(); }
+    Priority GetPriority() const { return _priority; }
+
+private:
+    UdpFrame() = default;
+
+    std::string _storage;
+    Priority _priority = Priority::Normal;
+};
+
+// outbound datagram, moved by value through the send queues
+struct SUdpSendData
+{
+    asio::ip::udp::endpoint endpoint;
+    std::shared_ptr<const UdpFrame> frame;
+};